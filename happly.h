@@ -48,18 +48,75 @@ SOFTWARE.
 */
 // clang-format on
 
+#include <algorithm>
 #include <array>
 #include <cctype>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 #include <climits>
+#include <cmath>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// io_uring is used through its system calls directly, so it needs only the kernel headers, from Linux 5.6 or later
+// (IO_URING_OP_SUPPORTED arrived with IORING_OP_READ and the opcode probe, which are used at runtime)
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(IO_URING_OP_SUPPORTED) && defined(IORING_FEAT_SINGLE_MMAP) && defined(IORING_ENTER_GETEVENTS) && \
+    defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define HAPPLY_IO_URING
+#endif
+#endif
+#endif
+
+// Vector instructions are used for byte swapping on x86. With GCC and Clang the kernels are compiled for specific
+// instruction sets and chosen at runtime; otherwise they are only used if the compiler targets AVX2.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define HAPPLY_SIMD_DISPATCH
+#define HAPPLY_SIMD_TARGET(arch) __attribute__((target(arch)))
+#elif defined(__AVX2__)
+#define HAPPLY_SIMD_TARGET(arch)
+#endif
+#endif
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
 
 // General namespace wrapping all Happly things.
 namespace happly {
@@ -68,6 +125,12 @@ namespace happly {
 // (default) or big endian.
 enum class DataFormat { ASCII, Binary, BinaryBigEndian };
 
+// How reading and writing files treats the operating system's page cache. Sequential tells the system that a file will
+// be read from start to end, so it can read further ahead. DropBehind also pushes each part of the file out of the
+// cache once it has been used, so that converting huge files does not evict everything else. Only used where
+// posix_fadvise is available (eg Linux).
+enum class PageCacheMode { Default, Sequential, DropBehind };
+
 // Type name strings
 // clang-format off
 template <typename T> std::string typeName()                { return "unknown"; }
@@ -116,1907 +179,6927 @@ S* addressIfSame(S& t, int) {return &t;}
 // clang-format on
 } // namespace
 
+
+// Number parsing for ASCII reading, directly from bytes in memory
+namespace {
+
+inline bool isDecimalDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
 /**
- * @brief A generic property, which is associated with some element. Can be plain Property or a ListProperty, of some
- * type.  Generally, the user should not need to interact with these directly, but they are exposed in case someone
- * wants to get clever.
+ * Parse an integer from the start of some text.
+ *
+ * @param begin Start of the text.
+ * @param end End of the text.
+ * @param value Output, the integer.
+ *
+ * @return The end of the integer, or begin if the text does not start with one, or it is out of range for T.
  */
-class Property {
+template <class T>
+typename std::enable_if<std::is_integral<T>::value, const char*>::type parseNumber(const char* begin, const char* end,
+                                                                                    T& value) {
+  const char* p = begin;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+  const char* digits = p;
+  uint64_t magnitude = 0;
+  for (; p < end && isDecimalDigit(*p); p++) {
+    uint64_t digit = static_cast<uint64_t>(*p - '0');
+    if (magnitude > (std::numeric_limits<uint64_t>::max() - digit) / 10) return begin;
+    magnitude = magnitude * 10 + digit;
+  }
+  if (p == digits) return begin;
+
+  // The largest magnitude T can hold with this sign
+  const uint64_t maxValue = static_cast<uint64_t>(std::numeric_limits<T>::max());
+  const uint64_t limit = !negative ? maxValue : std::is_signed<T>::value ? maxValue + 1 : 0;
+  if (magnitude > limit) return begin;
+  if (!negative || magnitude == 0) {
+    value = static_cast<T>(magnitude);
+  } else {
+    value = static_cast<T>(-static_cast<T>(magnitude - 1) - 1); // can be the minimum of T, whose negation is not
+  }
+  return p;
+}
 
-public:
-  /**
-   * @brief Create a new Property with the given name.
-   *
-   * @param name_
-   */
-  Property(const std::string& name_) : name(name_){};
-  virtual ~Property(){};
+/**
+ * Can a correctly rounded double be converted to F and still be correctly rounded? Always true for doubles. For
+ * floats, rounding twice only goes wrong when the double lands exactly halfway between two floats (and is then rounded
+ * again), so this checks for that, and that the value is in the range of normal floats.
+ */
+template <class F>
+bool narrowsCorrectly(double d) {
+  return true;
+}
+template <>
+inline bool narrowsCorrectly<float>(double d) {
+  if (d == 0.) return true;
+  if (std::abs(d) < std::numeric_limits<float>::min() || std::abs(d) > std::numeric_limits<float>::max()) return false;
+  uint64_t bits;
+  std::memcpy(&bits, &d, sizeof(d));
+  const uint64_t droppedBits = (uint64_t(1) << 29) - 1; // fraction bits of a double which a float does not have
+  return (bits & droppedBits) != (uint64_t(1) << 28);
+}
 
-  std::string name;
+/**
+ * Parse a floating point number from the start of some text. The result is correctly rounded: numbers with at most 19
+ * significant digits and a small exponent are computed exactly from a single multiplication or division (Clinger's
+ * fast path), and anything else falls back to the standard library.
+ *
+ * @param begin Start of the text.
+ * @param end End of the text.
+ * @param value Output, the number.
+ *
+ * @return The end of the number, or begin if the text does not start with one.
+ */
+template <class F>
+const char* parseFloat(const char* begin, const char* end, F& value) {
+  static const double powersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  const char* p = begin;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
 
-  /**
-   * @brief Reserve memory.
-   *
-   * @param capacity Expected number of elements.
-   */
-  virtual void reserve(size_t capacity) = 0;
+  // The significant digits, as an integer which is multiplied by 10^exponent. Only the first 19 are kept.
+  uint64_t mantissa = 0;
+  int nDigits = 0;
+  int exponent = 0;
+  bool truncated = false;
+  bool anyDigits = false;
+  bool fractional = false;
+  for (; p < end; p++) {
+    if (*p == '.' && !fractional) {
+      fractional = true;
+      continue;
+    }
+    if (!isDecimalDigit(*p)) break;
+    anyDigits = true;
+    int digit = *p - '0';
+    if (nDigits < 19) {
+      mantissa = mantissa * 10 + digit;
+      if (mantissa > 0) nDigits++;
+      if (fractional) exponent--;
+    } else {
+      truncated = truncated || digit != 0;
+      if (!fractional) exponent++;
+    }
+  }
 
-  /**
-   * @brief (ASCII reading) Parse out the next value of this property from a list of tokens.
-   *
-   * @param tokens The list of property tokens for the element.
-   * @param currEntry Index in to tokens, updated after this property is read.
-   */
-  virtual void parseNext(const std::vector<std::string>& tokens, size_t& currEntry) = 0;
+  if (!anyDigits) {
+    // Maybe infinity or NaN, which streams write as "inf" and "nan"
+    auto matches = [&](const char* word) {
+      size_t n = std::strlen(word);
+      if (static_cast<size_t>(end - p) < n) return false;
+      for (size_t i = 0; i < n; i++) {
+        if (std::tolower(static_cast<unsigned char>(p[i])) != word[i]) return false;
+      }
+      p += n;
+      return true;
+    };
+    if (matches("infinity") || matches("inf")) {
+      value = negative ? -std::numeric_limits<F>::infinity() : std::numeric_limits<F>::infinity();
+      return p;
+    }
+    if (matches("nan")) {
+      value = std::numeric_limits<F>::quiet_NaN();
+      return p;
+    }
+    return begin;
+  }
 
-  /**
-   * @brief (binary reading) Copy the next value of this property from a stream of bits.
-   *
-   * @param stream Stream to read from.
-   */
-  virtual void readNext(std::istream& stream) = 0;
+  // Exponent, if there is one
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char* q = p + 1;
+    bool negativeExponent = false;
+    if (q < end && (*q == '-' || *q == '+')) {
+      negativeExponent = *q == '-';
+      q++;
+    }
+    if (q < end && isDecimalDigit(*q)) {
+      int e = 0;
+      for (; q < end && isDecimalDigit(*q); q++) {
+        if (e < 100000) e = e * 10 + (*q - '0');
+      }
+      exponent += negativeExponent ? -e : e;
+      p = q;
+    }
+  }
 
-  /**
-   * @brief (binary reading) Copy the next value of this property from a stream of bits.
-   *
-   * @param stream Stream to read from.
-   */
-  virtual void readNextBigEndian(std::istream& stream) = 0;
+  if (mantissa == 0) {
+    value = negative ? -F(0) : F(0);
+    return p;
+  }
 
-  /**
-   * @brief (reading) Write a header entry for this property.
-   *
-   * @param outStream Stream to write to.
-   */
-  virtual void writeHeader(std::ostream& outStream) = 0;
+  // Both the mantissa and the power of ten are exact doubles, so one operation rounds correctly
+  if (!truncated && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+    double d = static_cast<double>(mantissa);
+    d = exponent < 0 ? d / powersOfTen[-exponent] : d * powersOfTen[exponent];
+    if (narrowsCorrectly<F>(d)) {
+      value = static_cast<F>(negative ? -d : d);
+      return p;
+    }
+  }
 
-  /**
-   * @brief (ASCII writing) write this property for some element to a stream in plaintext
-   *
-   * @param outStream Stream to write to.
-   * @param iElement index of the element to write.
-   */
-  virtual void writeDataASCII(std::ostream& outStream, size_t iElement) = 0;
+  // Slow but exact
+  std::istringstream iss(std::string(begin, p));
+  iss.imbue(std::locale::classic());
+  F parsed = 0;
+  iss >> parsed;
+  value = parsed;
+  return p;
+}
+
+inline const char* parseNumber(const char* begin, const char* end, float& value) {
+  return parseFloat(begin, end, value);
+}
+inline const char* parseNumber(const char* begin, const char* end, double& value) {
+  return parseFloat(begin, end, value);
+}
 
+inline bool isTokenSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+} // namespace
+
+
+/**
+ * @brief (ASCII reading) Splits a line of an ASCII element in to tokens separated by whitespace, and parses numbers
+ * from them, directly over the bytes of the line and without allocating.
+ */
+class ASCIITokenizer {
+
+public:
   /**
-   * @brief (binary writing) copy the bits of this property for some element to a stream
+   * @brief Start at the beginning of a line.
    *
-   * @param outStream Stream to write to.
-   * @param iElement index of the element to write.
+   * @param begin Start of the line.
+   * @param end_ End of the line, not including the newline.
    */
-  virtual void writeDataBinary(std::ostream& outStream, size_t iElement) = 0;
+  ASCIITokenizer(const char* begin, const char* end_) : pos(begin), end(end_) {}
 
   /**
-   * @brief (binary writing) copy the bits of this property for some element to a stream
+   * @brief Parse the next token as a number. Like reading with operator>>, a token which only starts with a number
+   * gives that number (so "2.5" read as an int gives 2). Throws if there are no tokens left, or the token is not a
+   * number (or for integers, is out of range for T).
    *
-   * @param outStream Stream to write to.
-   * @param iElement index of the element to write.
+   * @tparam T The type of number.
+   * @param name Name of the property being read, for error messages.
+   *
+   * @return The number.
    */
-  virtual void writeDataBinaryBigEndian(std::ostream& outStream, size_t iElement) = 0;
+  template <class T>
+  T next(const std::string& name) {
+    const char* tokenEnd = findToken(name);
+    T value = T();
+    if (parseNumber(pos, tokenEnd, value) == pos) {
+      throw std::runtime_error("PLY parser: could not parse \"" + std::string(pos, tokenEnd) +
+                               "\" as a value of property " + name);
+    }
+    pos = tokenEnd;
+    return value;
+  }
 
   /**
-   * @brief Number of element entries for this property
+   * @brief Skip the next token. Throws if there are no tokens left.
    *
-   * @return
+   * @param name Name of the property being read, for error messages.
    */
-  virtual size_t size() = 0;
+  void skip(const std::string& name) { pos = findToken(name); }
 
   /**
-   * @brief A string naming the type of the property
-   *
-   * @return
+   * @brief An upper bound on the number of tokens left in the line.
    */
-  virtual std::string propertyTypeName() = 0;
+  size_t maxTokensLeft() const { return static_cast<size_t>(end - pos + 1) / 2; }
+
+private:
+  // Move to the start of the next token, and return its end
+  const char* findToken(const std::string& name) {
+    while (pos < end && isTokenSpace(*pos)) pos++;
+    if (pos == end) throw std::runtime_error("PLY parser: missing value for property " + name);
+    const char* tokenEnd = pos;
+    while (tokenEnd < end && !isTokenSpace(*tokenEnd)) tokenEnd++;
+    return tokenEnd;
+  }
+
+  const char* pos;
+  const char* end;
 };
 
+// Number formatting for ASCII writing, directly in to bytes in memory
 namespace {
 
 /**
- * Check if the platform is little endian.
- * (not foolproof, but will work on most platforms)
+ * Write an integer as text.
  *
- * @return true if little endian
+ * @param buffer Where to write, with room for at least 24 bytes.
+ * @param value The integer.
+ *
+ * @return The end of the text.
  */
-bool isLittleEndian() {
-  int32_t oneVal = 0x1;
-  char* numPtr = (char*)&oneVal;
-  return (numPtr[0] == 1);
+template <class T>
+char* formatInteger(char* buffer, T value) {
+  typedef typename std::make_unsigned<T>::type U;
+  U magnitude = static_cast<U>(value);
+  if (value < 0) {
+    *buffer++ = '-';
+    magnitude = static_cast<U>(0 - magnitude);
+  }
+  char digits[24];
+  char* d = digits + sizeof(digits);
+  do {
+    *--d = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude > 0);
+  size_t n = digits + sizeof(digits) - d;
+  std::memcpy(buffer, d, n);
+  return buffer + n;
+}
+
+// Shortest round-trip formatting of floating point values, with the Grisu2 algorithm (Loitsch, "Printing
+// Floating-Point Numbers Quickly and Accurately with Integers", 2010). The digits always read back as exactly the same
+// value, and are the shortest such digits in all but a tiny fraction of cases.
+
+// A floating point value f * 2^e with a 64 bit significand
+struct DiyFp {
+  uint64_t f;
+  int e;
+};
+
+inline DiyFp diyFpSub(DiyFp x, DiyFp y) { return DiyFp{x.f - y.f, x.e}; }
+
+// The product of two values, rounded to a 64 bit significand
+inline DiyFp diyFpMul(DiyFp x, DiyFp y) {
+  const uint64_t xLo = x.f & 0xFFFFFFFFu;
+  const uint64_t xHi = x.f >> 32;
+  const uint64_t yLo = y.f & 0xFFFFFFFFu;
+  const uint64_t yHi = y.f >> 32;
+  const uint64_t p0 = xLo * yLo;
+  const uint64_t p1 = xLo * yHi;
+  const uint64_t p2 = xHi * yLo;
+  const uint64_t p3 = xHi * yHi;
+  uint64_t mid = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+  mid += uint64_t(1) << 31; // round
+  return DiyFp{p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32), x.e + y.e + 64};
+}
+
+inline DiyFp diyFpNormalize(DiyFp x) {
+  while ((x.f >> 63) == 0) {
+    x.f <<= 1;
+    x.e--;
+  }
+  return x;
 }
 
 /**
- * Swap endianness.
- *
- * @param value Value to swap.
- *
- * @return Swapped value.
+ * A positive finite value, and the boundaries halfway to its neighbours, between which any value reads back as it.
+ * All three are normalized to the same exponent.
  */
-template <typename T>
-T swapEndian(T val) {
-  char* bytes = reinterpret_cast<char*>(&val);
-  for (unsigned int i = 0; i < sizeof(val) / 2; i++) {
-    std::swap(bytes[sizeof(val) - 1 - i], bytes[i]);
-  }
-  return val;
+template <class F>
+void floatBoundaries(F value, DiyFp& w, DiyFp& minus, DiyFp& plus) {
+  typedef typename std::conditional<sizeof(F) == 4, uint32_t, uint64_t>::type Bits;
+  const int precision = std::numeric_limits<F>::digits; // including the hidden bit
+  const int bias = std::numeric_limits<F>::max_exponent - 1 + (precision - 1);
+  const uint64_t hiddenBit = uint64_t(1) << (precision - 1);
+
+  Bits bits;
+  std::memcpy(&bits, &value, sizeof(F));
+  const uint64_t biasedExponent = static_cast<uint64_t>(bits) >> (precision - 1);
+  const uint64_t fraction = static_cast<uint64_t>(bits) & (hiddenBit - 1);
+  DiyFp v = biasedExponent == 0 ? DiyFp{fraction, 1 - bias}
+                                : DiyFp{fraction + hiddenBit, static_cast<int>(biasedExponent) - bias};
+
+  // The gap below is half as big at the bottom of a binade
+  bool lowerCloser = fraction == 0 && biasedExponent > 1;
+  plus = diyFpNormalize(DiyFp{2 * v.f + 1, v.e - 1});
+  minus = lowerCloser ? DiyFp{4 * v.f - 1, v.e - 2} : DiyFp{2 * v.f - 1, v.e - 1};
+  minus = DiyFp{minus.f << (minus.e - plus.e), plus.e};
+  w = diyFpNormalize(v);
 }
 
-// The following specializations for single-byte types are used to avoid compiler warnings.
-template <> int8_t swapEndian<int8_t>(int8_t val) { return val; }
-template <> uint8_t swapEndian<uint8_t>(uint8_t val) { return val; }
+// A power of ten f * 2^e ~= 10^k
+struct CachedPower {
+  uint64_t f;
+  int e;
+  int k;
+};
 
+/**
+ * The cached power of ten c with which c * 2^e has a binary exponent between -60 and -32 (after multiplying two 64
+ * bit significands).
+ */
+inline CachedPower cachedPowerForExponent(int e) {
+  // clang-format off
+  static const CachedPower powers[] = {
+      {0xAB70FE17C79AC6CA, -1060, -300},
+      {0xFF77B1FCBEBCDC4F, -1034, -292},
+      {0xBE5691EF416BD60C, -1007, -284},
+      {0x8DD01FAD907FFC3C, -980, -276},
+      {0xD3515C2831559A83, -954, -268},
+      {0x9D71AC8FADA6C9B5, -927, -260},
+      {0xEA9C227723EE8BCB, -901, -252},
+      {0xAECC49914078536D, -874, -244},
+      {0x823C12795DB6CE57, -847, -236},
+      {0xC21094364DFB5637, -821, -228},
+      {0x9096EA6F3848984F, -794, -220},
+      {0xD77485CB25823AC7, -768, -212},
+      {0xA086CFCD97BF97F4, -741, -204},
+      {0xEF340A98172AACE5, -715, -196},
+      {0xB23867FB2A35B28E, -688, -188},
+      {0x84C8D4DFD2C63F3B, -661, -180},
+      {0xC5DD44271AD3CDBA, -635, -172},
+      {0x936B9FCEBB25C996, -608, -164},
+      {0xDBAC6C247D62A584, -582, -156},
+      {0xA3AB66580D5FDAF6, -555, -148},
+      {0xF3E2F893DEC3F126, -529, -140},
+      {0xB5B5ADA8AAFF80B8, -502, -132},
+      {0x87625F056C7C4A8B, -475, -124},
+      {0xC9BCFF6034C13053, -449, -116},
+      {0x964E858C91BA2655, -422, -108},
+      {0xDFF9772470297EBD, -396, -100},
+      {0xA6DFBD9FB8E5B88F, -369, -92},
+      {0xF8A95FCF88747D94, -343, -84},
+      {0xB94470938FA89BCF, -316, -76},
+      {0x8A08F0F8BF0F156B, -289, -68},
+      {0xCDB02555653131B6, -263, -60},
+      {0x993FE2C6D07B7FAC, -236, -52},
+      {0xE45C10C42A2B3B06, -210, -44},
+      {0xAA242499697392D3, -183, -36},
+      {0xFD87B5F28300CA0E, -157, -28},
+      {0xBCE5086492111AEB, -130, -20},
+      {0x8CBCCC096F5088CC, -103, -12},
+      {0xD1B71758E219652C, -77, -4},
+      {0x9C40000000000000, -50, 4},
+      {0xE8D4A51000000000, -24, 12},
+      {0xAD78EBC5AC620000, 3, 20},
+      {0x813F3978F8940984, 30, 28},
+      {0xC097CE7BC90715B3, 56, 36},
+      {0x8F7E32CE7BEA5C70, 83, 44},
+      {0xD5D238A4ABE98068, 109, 52},
+      {0x9F4F2726179A2245, 136, 60},
+      {0xED63A231D4C4FB27, 162, 68},
+      {0xB0DE65388CC8ADA8, 189, 76},
+      {0x83C7088E1AAB65DB, 216, 84},
+      {0xC45D1DF942711D9A, 242, 92},
+      {0x924D692CA61BE758, 269, 100},
+      {0xDA01EE641A708DEA, 295, 108},
+      {0xA26DA3999AEF774A, 322, 116},
+      {0xF209787BB47D6B85, 348, 124},
+      {0xB454E4A179DD1877, 375, 132},
+      {0x865B86925B9BC5C2, 402, 140},
+      {0xC83553C5C8965D3D, 428, 148},
+      {0x952AB45CFA97A0B3, 455, 156},
+      {0xDE469FBD99A05FE3, 481, 164},
+      {0xA59BC234DB398C25, 508, 172},
+      {0xF6C69A72A3989F5C, 534, 180},
+      {0xB7DCBF5354E9BECE, 561, 188},
+      {0x88FCF317F22241E2, 588, 196},
+      {0xCC20CE9BD35C78A5, 614, 204},
+      {0x98165AF37B2153DF, 641, 212},
+      {0xE2A0B5DC971F303A, 667, 220},
+      {0xA8D9D1535CE3B396, 694, 228},
+      {0xFB9B7CD9A4A7443C, 720, 236},
+      {0xBB764C4CA7A44410, 747, 244},
+      {0x8BAB8EEFB6409C1A, 774, 252},
+      {0xD01FEF10A657842C, 800, 260},
+      {0x9B10A4E5E9913129, 827, 268},
+      {0xE7109BFBA19C0C9D, 853, 276},
+      {0xAC2820D9623BF429, 880, 284},
+      {0x80444B5E7AA7CF85, 907, 292},
+      {0xBF21E44003ACDD2D, 933, 300},
+      {0x8E679C2F5E44FF8F, 960, 308},
+      {0xD433179D9C8CB841, 986, 316},
+      {0x9E19DB92B4E31BA9, 1013, 324},
+  };
+  // clang-format on
+  const int minDecimalExponent = -300;
+  const int decimalStep = 8;
+  const int f = -60 - e - 1;
+  const int k = (f * 78913) / (1 << 18) + static_cast<int>(f > 0); // ceil(f * log10(2))
+  return powers[(-minDecimalExponent + k + (decimalStep - 1)) / decimalStep];
+}
 
-// Unpack flattened list from the convention used in TypedListProperty
-template <typename T>
-std::vector<std::vector<T>> unflattenList(const std::vector<T>& flatList, const std::vector<size_t> flatListStarts) {
-  size_t outerCount = flatListStarts.size() - 1;
+// Nudge the last digit towards w, while it stays within the boundaries
+inline void grisuRound(char* digits, int nDigits, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t tenK) {
+  while (rest < dist && delta - rest >= tenK && (rest + tenK < dist || dist - rest > rest + tenK - dist)) {
+    digits[nDigits - 1]--;
+    rest += tenK;
+  }
+}
 
-  // Put the output here
-  std::vector<std::vector<T>> outLists(outerCount);
+/**
+ * Generate the shortest digits of a positive finite value, which is digits * 10^exponent.
+ *
+ * @param value The value.
+ * @param digits Output, with room for 17 digits.
+ * @param nDigits Output, the number of digits.
+ * @param exponent Output, the decimal exponent.
+ */
+template <class F>
+void grisu2(F value, char* digits, int& nDigits, int& exponent) {
+  DiyFp v, minus, plus;
+  floatBoundaries(value, v, minus, plus);
+
+  // Scale by a power of ten so that the integer part of the upper boundary has a handful of digits
+  CachedPower cached = cachedPowerForExponent(plus.e);
+  DiyFp c{cached.f, cached.e};
+  DiyFp w = diyFpMul(v, c);
+  DiyFp wMinus = diyFpMul(minus, c);
+  DiyFp wPlus = diyFpMul(plus, c);
+  DiyFp low{wMinus.f + 1, wMinus.e}; // stay inside the boundaries, despite the rounding of the products
+  DiyFp high{wPlus.f - 1, wPlus.e};
+  exponent = -cached.k;
+
+  uint64_t delta = diyFpSub(high, low).f;
+  uint64_t dist = diyFpSub(high, w).f;
+  const int shift = -high.e;
+  const uint64_t one = uint64_t(1) << shift;
+  uint32_t integral = static_cast<uint32_t>(high.f >> shift);
+  uint64_t fractional = high.f & (one - 1);
+  nDigits = 0;
+
+  // Digits of the integral part, stopping as soon as the rest is within the boundaries
+  uint32_t pow10 = 1;
+  int nIntegral = 1;
+  while (nIntegral < 10 && integral >= pow10 * 10) {
+    pow10 *= 10;
+    nIntegral++;
+  }
+  for (int n = nIntegral; n > 0; n--) {
+    digits[nDigits++] = static_cast<char>('0' + integral / pow10);
+    integral %= pow10;
+    uint64_t rest = (static_cast<uint64_t>(integral) << shift) + fractional;
+    if (rest <= delta) {
+      exponent += n - 1;
+      grisuRound(digits, nDigits, dist, delta, rest, static_cast<uint64_t>(pow10) << shift);
+      return;
+    }
+    pow10 /= 10;
+  }
 
-  if (outerCount == 0) {
-    return outLists; // quick out for empty
+  // Digits of the fractional part
+  int nFractional = 0;
+  while (true) {
+    fractional *= 10;
+    digits[nDigits++] = static_cast<char>('0' + (fractional >> shift));
+    fractional &= one - 1;
+    nFractional++;
+    delta *= 10;
+    dist *= 10;
+    if (fractional <= delta) break;
   }
+  exponent -= nFractional;
+  grisuRound(digits, nDigits, dist, delta, fractional, one);
+}
 
-  // Copy each sublist
-  for (size_t iOuter = 0; iOuter < outerCount; iOuter++) {
-    size_t iFlatStart = flatListStarts[iOuter];
-    size_t iFlatEnd = flatListStarts[iOuter + 1];
-    outLists[iOuter].insert(outLists[iOuter].begin(), flatList.begin() + iFlatStart, flatList.begin() + iFlatEnd);
+/**
+ * Lay out digits * 10^exponent as text, in plain notation if the decimal point is near the digits, and otherwise in
+ * scientific notation like "1.5e-07".
+ *
+ * @param buffer Where to write, with room for at least 32 bytes.
+ * @param digits The significant digits, with no leading or trailing zeros.
+ * @param nDigits Number of digits, at most 17.
+ * @param exponent The decimal exponent.
+ * @param maxPlainExponent Largest number of integer digits to write in plain notation.
+ *
+ * @return The end of the text.
+ */
+inline char* layoutDecimal(char* buffer, const char* digits, int nDigits, int exponent, int maxPlainExponent) {
+  int point = nDigits + exponent; // position of the decimal point, relative to the first digit
+  if (nDigits <= point && point <= maxPlainExponent) {
+    std::memcpy(buffer, digits, nDigits);
+    std::memset(buffer + nDigits, '0', point - nDigits);
+    return buffer + point;
+  }
+  if (0 < point && point <= maxPlainExponent) {
+    std::memcpy(buffer, digits, point);
+    buffer[point] = '.';
+    std::memcpy(buffer + point + 1, digits + point, nDigits - point);
+    return buffer + nDigits + 1;
+  }
+  if (-4 < point && point <= 0) {
+    buffer[0] = '0';
+    buffer[1] = '.';
+    std::memset(buffer + 2, '0', -point);
+    std::memcpy(buffer + 2 - point, digits, nDigits);
+    return buffer + 2 - point + nDigits;
   }
 
-  return outLists;
+  *buffer++ = digits[0];
+  if (nDigits > 1) {
+    *buffer++ = '.';
+    std::memcpy(buffer, digits + 1, nDigits - 1);
+    buffer += nDigits - 1;
+  }
+  *buffer++ = 'e';
+  int e = point - 1;
+  *buffer++ = e < 0 ? '-' : '+';
+  e = std::abs(e);
+  if (e >= 100) *buffer++ = static_cast<char>('0' + e / 100);
+  *buffer++ = static_cast<char>('0' + e / 10 % 10);
+  *buffer++ = static_cast<char>('0' + e % 10);
+  return buffer;
+}
+
+/**
+ * Write a floating point value as text.
+ *
+ * @param buffer Where to write, with room for at least 32 bytes.
+ * @param value The value.
+ * @param precision Number of significant digits, or 0 for the shortest text which reads back as exactly the same value.
+ *
+ * @return The end of the text.
+ */
+template <class F>
+char* formatFloat(char* buffer, F value, int precision) {
+  if (std::isnan(value)) {
+    std::memcpy(buffer, "nan", 3);
+    return buffer + 3;
+  }
+  if (std::signbit(value)) {
+    *buffer++ = '-';
+    value = -value;
+  }
+  if (std::isinf(value)) {
+    std::memcpy(buffer, "inf", 3);
+    return buffer + 3;
+  }
+  if (value == 0) {
+    *buffer = '0';
+    return buffer + 1;
+  }
+
+  char digits[32];
+  int nDigits;
+  int exponent;
+  if (precision <= 0) {
+    grisu2(value, digits, nDigits, exponent);
+  } else {
+    // Let printf round, then pick out just the digits and exponent, since the decimal point depends on the locale
+    precision = std::min(precision, std::numeric_limits<F>::max_digits10);
+    char text[48];
+    std::snprintf(text, sizeof(text), "%.*e", precision - 1, static_cast<double>(value));
+    nDigits = 0;
+    const char* t = text;
+    for (; *t != 'e'; t++) {
+      if (isDecimalDigit(*t)) digits[nDigits++] = *t;
+    }
+    exponent = std::atoi(t + 1) - (nDigits - 1);
+    while (nDigits > 1 && digits[nDigits - 1] == '0') {
+      nDigits--;
+      exponent++;
+    }
+  }
+  return layoutDecimal(buffer, digits, nDigits, exponent, std::numeric_limits<F>::digits10);
 }
 
+inline char* formatNumber(char* buffer, float value, int precision) { return formatFloat(buffer, value, precision); }
+inline char* formatNumber(char* buffer, double value, int precision) { return formatFloat(buffer, value, precision); }
+template <class T>
+typename std::enable_if<std::is_integral<T>::value, char*>::type formatNumber(char* buffer, T value, int precision) {
+  return formatInteger(buffer, value);
+}
 
-}; // namespace
+} // namespace
 
 
 /**
- * @brief A property which takes a single value (not a list).
+ * @brief (writing) Collects bytes in a large block, and writes them to a stream a block at a time.
  */
-template <class T>
-class TypedProperty : public Property {
+class BufferedWriter {
 
 public:
   /**
-   * @brief Create a new Property with the given name.
+   * @brief Prepare to write to a stream. Call flush() when done; nothing is written when the writer is destroyed.
    *
-   * @param name_
+   * @param stream_ The stream to write to.
+   * @param blockBytes_ Number of bytes to collect before writing them.
    */
-  TypedProperty(const std::string& name_) : Property(name_) {
-    if (typeName<T>() == "unknown") {
-      // TODO should really be a compile-time error
-      throw std::runtime_error("Attempted property type does not match any type defined by the .ply format.");
-    }
-  };
+  BufferedWriter(std::ostream& stream_, size_t blockBytes_ = 1 << 22)
+      : stream(&stream_), buffer(std::max<size_t>(blockBytes_, 64)), base(buffer.data()), capacity(buffer.size()) {}
 
   /**
-   * @brief Create a new property and initialize with data.
+   * @brief Prepare to collect bytes in memory, growing as needed, rather than writing them to a stream. The bytes are
+   * available from data() and size().
    *
-   * @param name_
-   * @param data_
+   * @param blockBytes_ Number of bytes to make room for at the start.
    */
-  TypedProperty(const std::string& name_, const std::vector<T>& data_) : Property(name_), data(data_) {
-    if (typeName<T>() == "unknown") {
-      throw std::runtime_error("Attempted property type does not match any type defined by the .ply format.");
-    }
-  };
-
-  virtual ~TypedProperty() override{};
+  explicit BufferedWriter(size_t blockBytes_)
+      : stream(nullptr), buffer(std::max<size_t>(blockBytes_, 64)), base(buffer.data()), capacity(buffer.size()) {}
 
   /**
-   * @brief Reserve memory.
+   * @brief Prepare to put bytes straight in to some memory owned by the caller, such as part of a file mapped for
+   * writing. Throws if more bytes are added than fit.
    *
-   * @param capacity Expected number of elements.
+   * @param dst_ Where the bytes go.
+   * @param capacity_ Number of bytes which fit.
    */
-  virtual void reserve(size_t capacity) override { data.reserve(capacity); }
+  BufferedWriter(char* dst_, size_t capacity_) : stream(nullptr), base(dst_), capacity(capacity_), fixed(true) {}
 
   /**
-   * @brief (ASCII reading) Parse out the next value of this property from a list of tokens.
+   * @brief Call a function after each write to the stream, eg to push the data on out of the page cache.
    *
-   * @param tokens The list of property tokens for the element.
-   * @param currEntry Index in to tokens, updated after this property is read.
+   * @param afterWrite_ The function.
    */
-  virtual void parseNext(const std::vector<std::string>& tokens, size_t& currEntry) override {
-    data.emplace_back();
-    std::istringstream iss(tokens[currEntry]);
-    typename SerializeType<T>::type tmp; // usually the same type as T
-    iss >> tmp;
-    data.back() = tmp;
-    currEntry++;
-  };
+  void setWriteHook(std::function<void()> afterWrite_) { afterWrite = std::move(afterWrite_); }
 
   /**
-   * @brief (binary reading) Copy the next value of this property from a stream of bits.
+   * @brief Make room for some bytes, writing out those collected so far if necessary.
    *
-   * @param stream Stream to read from.
-   */
-  virtual void readNext(std::istream& stream) override {
-    data.emplace_back();
-    stream.read((char*)&data.back(), sizeof(T));
-  }
-
-  /**
-   * @brief (binary reading) Copy the next value of this property from a stream of bits.
+   * @param nBytes Number of bytes needed.
    *
-   * @param stream Stream to read from.
+   * @return Where to put the bytes. Call commit() once they are there.
    */
-  virtual void readNextBigEndian(std::istream& stream) override {
-    data.emplace_back();
-    stream.read((char*)&data.back(), sizeof(T));
-    data.back() = swapEndian(data.back());
+  char* reserve(size_t nBytes) {
+    if (capacity - used < nBytes) {
+      flush();
+      if (capacity - used < nBytes) grow(used + nBytes);
+    }
+    return base + used;
   }
 
   /**
-   * @brief (reading) Write a header entry for this property.
+   * @brief Add bytes which were put in the space from reserve().
    *
-   * @param outStream Stream to write to.
+   * @param nBytes Number of bytes.
    */
-  virtual void writeHeader(std::ostream& outStream) override {
-    outStream << "property " << typeName<T>() << " " << name << "\n";
-  }
+  void commit(size_t nBytes) { used += nBytes; }
 
   /**
-   * @brief (ASCII writing) write this property for some element to a stream in plaintext
+   * @brief Add a single byte.
    *
-   * @param outStream Stream to write to.
-   * @param iElement index of the element to write.
+   * @param c The byte.
    */
-  virtual void writeDataASCII(std::ostream& outStream, size_t iElement) override {
-    outStream.precision(std::numeric_limits<T>::max_digits10);
-    outStream << static_cast<typename SerializeType<T>::type>(data[iElement]); // case is usually a no-op
+  void put(char c) {
+    if (used == capacity) reserve(1);
+    base[used++] = c;
   }
 
   /**
-   * @brief (binary writing) copy the bits of this property for some element to a stream
+   * @brief Add some bytes. Large amounts go straight to the stream.
    *
-   * @param outStream Stream to write to.
-   * @param iElement index of the element to write.
+   * @param data The bytes.
+   * @param nBytes Number of bytes.
    */
-  virtual void writeDataBinary(std::ostream& outStream, size_t iElement) override {
-    outStream.write((char*)&data[iElement], sizeof(T));
+  void write(const char* data, size_t nBytes) {
+    if (stream != nullptr && nBytes >= capacity) {
+      flush();
+      stream->write(data, nBytes);
+      if (afterWrite) afterWrite();
+      return;
+    }
+    if (nBytes == 0) return;
+    std::memcpy(reserve(nBytes), data, nBytes);
+    commit(nBytes);
   }
 
   /**
-   * @brief (binary writing) copy the bits of this property for some element to a stream
-   *
-   * @param outStream Stream to write to.
-   * @param iElement index of the element to write.
+   * @brief Write everything collected so far to the stream. Does nothing when writing to memory.
    */
-  virtual void writeDataBinaryBigEndian(std::ostream& outStream, size_t iElement) override {
-    auto value = swapEndian(data[iElement]);
-    outStream.write((char*)&value, sizeof(T));
+  void flush() {
+    if (stream == nullptr || used == 0) return;
+    stream->write(base, used);
+    used = 0;
+    if (afterWrite) afterWrite();
   }
 
   /**
-   * @brief Number of element entries for this property
-   *
-   * @return
+   * @brief (writing to memory) The bytes collected so far.
    */
-  virtual size_t size() override { return data.size(); }
-
+  const char* data() const { return base; }
 
   /**
-   * @brief A string naming the type of the property
-   *
-   * @return
+   * @brief Number of bytes collected and not yet written.
    */
-  virtual std::string propertyTypeName() override { return typeName<T>(); }
+  size_t size() const { return used; }
 
   /**
-   * @brief The actual data contained in the property
+   * @brief Throw away the bytes collected so far, keeping the memory for reuse.
    */
-  std::vector<T> data;
+  void clear() { used = 0; }
+
+private:
+  // Make room for at least some number of bytes in total
+  void grow(size_t nBytes) {
+    if (fixed) {
+      throw std::runtime_error("Ply writer: data does not fit in the space set aside for it");
+    }
+    buffer.resize(std::max(nBytes, 2 * capacity));
+    base = buffer.data();
+    capacity = buffer.size();
+  }
+
+  std::ostream* stream; // null when writing to memory
+  std::vector<char> buffer;
+  char* base; // where the bytes go, either buffer or the caller's memory
+  size_t capacity;
+  size_t used = 0;
+  bool fixed = false; // whether base is the caller's memory, which can not grow
+  std::function<void()> afterWrite;
 };
 
 
 /**
- * @brief A property which is a list of value (eg, 3 doubles). Note that lists are always variable length per-element.
+ * @brief (ASCII writing) Formats numbers as text directly in to a BufferedWriter, independent of any locale.
  */
-template <class T>
-class TypedListProperty : public Property {
+class ASCIIWriter {
 
 public:
   /**
-   * @brief Create a new Property with the given name.
+   * @brief Format in to a writer.
    *
-   * @param name_
+   * @param out_ Where the text goes.
+   * @param precision_ Number of significant digits for floating point values, or 0 for the shortest text which reads
+   * back as exactly the same value (see WriteOptions::precision).
    */
-  TypedListProperty(const std::string& name_, int listCountBytes_) : Property(name_), listCountBytes(listCountBytes_) {
-    if (typeName<T>() == "unknown") {
-      throw std::runtime_error("Attempted property type does not match any type defined by the .ply format.");
-    }
+  ASCIIWriter(BufferedWriter& out_, int precision_ = 0) : out(out_), precision(precision_) {}
 
-    flattenedIndexStart.push_back(0);
-  };
+  /**
+   * @brief Write a number.
+   *
+   * @param value The number.
+   */
+  template <class T>
+  void write(T value) {
+    char* start = out.reserve(32);
+    out.commit(formatNumber(start, value, precision) - start);
+  }
 
   /**
-   * @brief Create a new property and initialize with data
+   * @brief Write a single character, such as a separator.
+   *
+   * @param c The character.
+   */
+  void put(char c) { out.put(c); }
+
+private:
+  BufferedWriter& out;
+  int precision;
+};
+
+
+/**
+ * @brief A generic property, which is associated with some element. Can be plain Property or a ListProperty, of some
+ * type.  Generally, the user should not need to interact with these directly, but they are exposed in case someone
+ * wants to get clever.
+ */
+class Property {
+
+public:
+  /**
+   * @brief Create a new Property with the given name.
    *
    * @param name_
-   * @param data_
    */
-  TypedListProperty(const std::string& name_, const std::vector<std::vector<T>>& data_) : Property(name_) {
-    if (typeName<T>() == "unknown") {
-      throw std::runtime_error("Attempted property type does not match any type defined by the .ply format.");
-    }
+  Property(const std::string& name_) : name(name_){};
+  virtual ~Property(){};
 
-    // Populate list with data
-    flattenedIndexStart.push_back(0);
-    for (const std::vector<T>& vec : data_) {
-      for (const T& val : vec) {
-        flattenedData.emplace_back(val);
-      }
-      flattenedIndexStart.push_back(flattenedData.size());
-    }
-  };
+  std::string name;
 
-  virtual ~TypedListProperty() override{};
+  /**
+   * @brief Create a new property with the same name and type as this one, but no data.
+   *
+   * @return The new property.
+   */
+  virtual std::unique_ptr<Property> emptyCopy() = 0;
 
   /**
    * @brief Reserve memory.
    *
    * @param capacity Expected number of elements.
    */
-  virtual void reserve(size_t capacity) override {
-    flattenedData.reserve(3 * capacity); // optimize for triangle meshes
-    flattenedIndexStart.reserve(capacity + 1);
-  }
+  virtual void reserve(size_t capacity) = 0;
 
   /**
-   * @brief (ASCII reading) Parse out the next value of this property from a list of tokens.
+   * @brief Set the number of element entries for this property. New entries are default-initialized (for list
+   * properties, only the list starts are resized, see TypedListProperty::flattenedIndexStart).
    *
-   * @param tokens The list of property tokens for the element.
-   * @param currEntry Index in to tokens, updated after this property is read.
+   * @param count New number of entries.
    */
-  virtual void parseNext(const std::vector<std::string>& tokens, size_t& currEntry) override {
-
-    std::istringstream iss(tokens[currEntry]);
-    size_t count;
-    iss >> count;
-    currEntry++;
-
-    size_t currSize = flattenedData.size();
-    size_t afterSize = currSize + count;
-    flattenedData.resize(afterSize);
-    for (size_t iFlat = currSize; iFlat < afterSize; iFlat++) {
-      std::istringstream iss(tokens[currEntry]);
-      typename SerializeType<T>::type tmp; // usually the same type as T
-      iss >> tmp;
-      flattenedData[iFlat] = tmp;
-      currEntry++;
-    }
-    flattenedIndexStart.emplace_back(afterSize);
-  }
+  virtual void resize(size_t count) = 0;
 
   /**
-   * @brief (binary reading) Copy the next value of this property from a stream of bits.
+   * @brief (ASCII reading) Parse out the next value of this property from the tokens of a line.
    *
-   * @param stream Stream to read from.
+   * @param tokens The tokens of the element's line, positioned at this property.
    */
-  virtual void readNext(std::istream& stream) override {
-
-    // Read the size of the list
-    size_t count = 0;
-    stream.read(((char*)&count), listCountBytes);
-
-    // Read list elements
-    size_t currSize = flattenedData.size();
-    size_t afterSize = currSize + count;
-    flattenedData.resize(afterSize);
-    if (count > 0) {
-      stream.read((char*)&flattenedData[currSize], count * sizeof(T));
-    }
-    flattenedIndexStart.emplace_back(afterSize);
-  }
+  virtual void parseNext(ASCIITokenizer& tokens) = 0;
 
   /**
-   * @brief (binary reading) Copy the next value of this property from a stream of bits.
+   * @brief (binary reading) The number of bytes this property occupies in every record, or 0 if the width varies from
+   * record to record (as it does for list properties).
    *
-   * @param stream Stream to read from.
+   * @return The width in bytes.
    */
-  virtual void readNextBigEndian(std::istream& stream) override {
-
-    // Read the size of the list
-    size_t count = 0;
-    stream.read(((char*)&count), listCountBytes);
-    if (listCountBytes == 8) {
-      count = (size_t)swapEndian((uint64_t)count);
-    } else if (listCountBytes == 4) {
-      count = (size_t)swapEndian((uint32_t)count);
-    } else if (listCountBytes == 2) {
-      count = (size_t)swapEndian((uint16_t)count);
-    }
+  virtual size_t fixedByteWidth() = 0;
 
-    // Read list elements
-    size_t currSize = flattenedData.size();
-    size_t afterSize = currSize + count;
-    flattenedData.resize(afterSize);
-    if (count > 0) {
-      stream.read((char*)&flattenedData[currSize], count * sizeof(T));
-    }
-    flattenedIndexStart.emplace_back(afterSize);
+  /**
+   * @brief (binary reading) The number of bytes occupied by one entry of this property, determined without decoding it.
+   *
+   * @param entry Pointer to the start of the entry.
+   * @param end End of the available bytes.
+   * @param bigEndian Is the data stored big endian?
+   *
+   * @return The width of the entry in bytes, which may extend past `end`. Returns 0 if there are not enough bytes
+   * available to determine the width.
+   */
+  virtual size_t entryByteWidth(const char* entry, const char* end, bool bigEndian) = 0;
 
-    // Swap endian order of list elements
-    for (size_t iFlat = currSize; iFlat < afterSize; iFlat++) {
-      flattenedData[iFlat] = swapEndian(flattenedData[iFlat]);
-    }
-  }
+  /**
+   * @brief (binary reading) The number of bytes in each value of this property (or in each value of the list, for list
+   * properties).
+   *
+   * @return The width in bytes.
+   */
+  virtual size_t valueByteWidth() = 0;
 
   /**
-   * @brief (reading) Write a header entry for this property. Note that we already use "uchar" for the list count type.
+   * @brief (binary reading) The number of bytes in the count which precedes each list, or 0 for properties which are
+   * not lists.
    *
-   * @param outStream Stream to write to.
+   * @return The width in bytes.
    */
-  virtual void writeHeader(std::ostream& outStream) override {
-    // NOTE: We ALWAYS use uchar as the list count output type
-    outStream << "property list uchar " << typeName<T>() << " " << name << "\n";
-  }
+  virtual size_t listCountByteWidth() = 0;
 
   /**
-   * @brief (ASCII writing) write this property for some element to a stream in plaintext
+   * @brief (binary reading) Raw pointer to the storage for this property's values (TypedProperty::data, or
+   * TypedListProperty::flattenedData), so that values can be decoded directly in to place. Invalidated by resize() and
+   * resizeValues().
    *
-   * @param outStream Stream to write to.
-   * @param iElement index of the element to write.
+   * @return The pointer, which may be null if there are no values.
    */
-  virtual void writeDataASCII(std::ostream& outStream, size_t iElement) override {
-    size_t dataStart = flattenedIndexStart[iElement];
-    size_t dataEnd = flattenedIndexStart[iElement + 1];
+  virtual char* valueStorage() = 0;
 
-    // Get the number of list elements as a uchar, and ensure the value fits
-    size_t dataCount = dataEnd - dataStart;
-    if (dataCount > std::numeric_limits<uint8_t>::max()) {
-      throw std::runtime_error(
-          "List property has an element with more entries than fit in a uchar. See note in README.");
-    }
+  /**
+   * @brief (binary reading) Raw pointer to TypedListProperty::flattenedIndexStart, for decoding lists directly in to
+   * place. Invalidated by resize().
+   *
+   * @return The pointer, or null for properties which are not lists.
+   */
+  virtual size_t* listStartStorage() = 0;
 
-    outStream << dataCount;
-    outStream.precision(std::numeric_limits<T>::max_digits10);
-    for (size_t iFlat = dataStart; iFlat < dataEnd; iFlat++) {
-      outStream << " " << static_cast<typename SerializeType<T>::type>(flattenedData[iFlat]); // cast is usually a no-op
-    }
-  }
+  /**
+   * @brief Set the total number of values stored by this property. For plain properties this is the same as resize();
+   * for list properties, it is the size of TypedListProperty::flattenedData.
+   *
+   * @param nValues New number of values.
+   */
+  virtual void resizeValues(size_t nValues) = 0;
 
   /**
-   * @brief (binary writing) copy the bits of this property for some element to a stream
+   * @brief (reading) Write a header entry for this property.
    *
    * @param outStream Stream to write to.
-   * @param iElement index of the element to write.
    */
-  virtual void writeDataBinary(std::ostream& outStream, size_t iElement) override {
-    size_t dataStart = flattenedIndexStart[iElement];
-    size_t dataEnd = flattenedIndexStart[iElement + 1];
-
-    // Get the number of list elements as a uchar, and ensure the value fits
-    size_t dataCount = dataEnd - dataStart;
-    if (dataCount > std::numeric_limits<uint8_t>::max()) {
-      throw std::runtime_error(
-          "List property has an element with more entries than fit in a uchar. See note in README.");
-    }
-    uint8_t count = static_cast<uint8_t>(dataCount);
-
-    outStream.write((char*)&count, sizeof(uint8_t));
-    outStream.write((char*)&flattenedData[dataStart], count * sizeof(T));
-  }
+  virtual void writeHeader(std::ostream& outStream) = 0;
 
   /**
-   * @brief (binary writing) copy the bits of this property for some element to a stream
+   * @brief (ASCII writing) write this property for some element in plaintext
    *
-   * @param outStream Stream to write to.
+   * @param out Writer to format the text with.
    * @param iElement index of the element to write.
    */
-  virtual void writeDataBinaryBigEndian(std::ostream& outStream, size_t iElement) override {
-    size_t dataStart = flattenedIndexStart[iElement];
-    size_t dataEnd = flattenedIndexStart[iElement + 1];
-
-    // Get the number of list elements as a uchar, and ensure the value fits
-    size_t dataCount = dataEnd - dataStart;
-    if (dataCount > std::numeric_limits<uint8_t>::max()) {
-      throw std::runtime_error(
-          "List property has an element with more entries than fit in a uchar. See note in README.");
-    }
-    uint8_t count = static_cast<uint8_t>(dataCount);
-
-    outStream.write((char*)&count, sizeof(uint8_t));
-    for (size_t iFlat = dataStart; iFlat < dataEnd; iFlat++) {
-      T value = swapEndian(flattenedData[iFlat]);
-      outStream.write((char*)&value, sizeof(T));
-    }
-  }
+  virtual void writeDataASCII(ASCIIWriter& out, size_t iElement) = 0;
 
   /**
    * @brief Number of element entries for this property
    *
    * @return
    */
-  virtual size_t size() override { return flattenedIndexStart.size() - 1; }
-
+  virtual size_t size() = 0;
 
   /**
    * @brief A string naming the type of the property
    *
    * @return
    */
-  virtual std::string propertyTypeName() override { return typeName<T>(); }
+  virtual std::string propertyTypeName() = 0;
+};
 
-  /**
-   * @brief The (flattened) data for the property, as formed by concatenating all of the individual element lists
-   * together.
-   */
-  std::vector<T> flattenedData;
+namespace {
 
-  /**
-   * @brief Indices in to flattenedData. The i'th element gives the index in to flattenedData where the element's data
-   * begins. A final entry is included which is the length of flattenedData. Size is N_elem + 1.
-   */
-  std::vector<size_t> flattenedIndexStart;
+/**
+ * Check if the platform is little endian.
+ * (not foolproof, but will work on most platforms)
+ *
+ * @return true if little endian
+ */
+bool isLittleEndian() {
+  int32_t oneVal = 0x1;
+  char* numPtr = (char*)&oneVal;
+  return (numPtr[0] == 1);
+}
 
-  /**
-   * @brief The number of bytes used to store the count for lists of data.
-   */
-  int listCountBytes = -1;
+// Reverse the bytes of an unsigned integer, using the compiler's intrinsic where there is one.
+inline uint16_t byteSwap(uint16_t val) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_bswap16(val);
+#elif defined(_MSC_VER)
+  return _byteswap_ushort(val);
+#else
+  return static_cast<uint16_t>((val >> 8) | (val << 8));
+#endif
+}
+inline uint32_t byteSwap(uint32_t val) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_bswap32(val);
+#elif defined(_MSC_VER)
+  return _byteswap_ulong(val);
+#else
+  return (val >> 24) | ((val >> 8) & 0x0000FF00u) | ((val << 8) & 0x00FF0000u) | (val << 24);
+#endif
+}
+inline uint64_t byteSwap(uint64_t val) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_bswap64(val);
+#elif defined(_MSC_VER)
+  return _byteswap_uint64(val);
+#else
+  return (static_cast<uint64_t>(byteSwap(static_cast<uint32_t>(val))) << 32) | byteSwap(static_cast<uint32_t>(val >> 32));
+#endif
+}
+
+// Swap the bytes of a value with N bytes. The general case reverses the bytes one at a time, and the sizes of the
+// PLY types are specialized to a single byte swap instruction.
+template <size_t N>
+struct ByteSwapper {
+  template <typename T>
+  static T swap(T val) {
+    char* bytes = reinterpret_cast<char*>(&val);
+    for (unsigned int i = 0; i < sizeof(val) / 2; i++) {
+      std::swap(bytes[sizeof(val) - 1 - i], bytes[i]);
+    }
+    return val;
+  }
+};
+template <>
+struct ByteSwapper<1> {
+  template <typename T>
+  static T swap(T val) {
+    return val;
+  }
+};
+template <size_t N, typename U>
+struct UnsignedByteSwapper {
+  template <typename T>
+  static T swap(T val) {
+    U bits;
+    std::memcpy(&bits, &val, N);
+    bits = byteSwap(bits);
+    std::memcpy(&val, &bits, N);
+    return val;
+  }
 };
+template <>
+struct ByteSwapper<2> : UnsignedByteSwapper<2, uint16_t> {};
+template <>
+struct ByteSwapper<4> : UnsignedByteSwapper<4, uint32_t> {};
+template <>
+struct ByteSwapper<8> : UnsignedByteSwapper<8, uint64_t> {};
+
+/**
+ * Swap endianness.
+ *
+ * @param value Value to swap.
+ *
+ * @return Swapped value.
+ */
+template <typename T>
+T swapEndian(T val) {
+  return ByteSwapper<sizeof(T)>::swap(val);
+}
 
+#if defined(HAPPLY_SIMD_TARGET)
 
 /**
- * @brief Helper function to construct a new property of the appropriate type.
+ * Swap the endianness of values in place with SSSE3 byte shuffles, 16 bytes at a time.
  *
- * @param name The name of the property to construct.
- * @param typeStr A string naming the type according to the format.
- * @param isList Is this a plain property, or a list property?
- * @param listCountTypeStr If a list property, the type of the count varible.
+ * @param bytes The values to swap.
+ * @param nBytes Number of bytes of values.
+ * @param shuffle The byte shuffle which swaps each value in 16 bytes.
  *
- * @return A new Property with the proper type.
+ * @return The number of bytes swapped, which is nBytes rounded down to a multiple of 16.
  */
-inline std::unique_ptr<Property> createPropertyWithType(const std::string& name, const std::string& typeStr,
-                                                        bool isList, const std::string& listCountTypeStr) {
+HAPPLY_SIMD_TARGET("ssse3")
+inline size_t swapEndianSSSE3(char* bytes, size_t nBytes, const char* shuffle) {
+  __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shuffle));
+  size_t i = 0;
+  for (; i + 16 <= nBytes; i += 16) {
+    __m128i vals = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(bytes + i), _mm_shuffle_epi8(vals, mask));
+  }
+  return i;
+}
 
-  // == Figure out how many bytes the list count field has, if this is a list type
-  // Note: some files seem to use signed types here, we read the width but always parse as if unsigned
-  int listCountBytes = -1;
-  if (isList) {
-    if (listCountTypeStr == "uchar" || listCountTypeStr == "uint8" || listCountTypeStr == "char" ||
-        listCountTypeStr == "int8") {
-      listCountBytes = 1;
-    } else if (listCountTypeStr == "ushort" || listCountTypeStr == "uint16" || listCountTypeStr == "short" ||
-               listCountTypeStr == "int16") {
-      listCountBytes = 2;
-    } else if (listCountTypeStr == "uint" || listCountTypeStr == "uint32" || listCountTypeStr == "int" ||
-               listCountTypeStr == "int32") {
-      listCountBytes = 4;
-    } else {
-      throw std::runtime_error("Unrecognized list count type: " + listCountTypeStr);
-    }
+/**
+ * Swap the endianness of values in place with AVX2 byte shuffles, 32 bytes at a time.
+ *
+ * @param bytes The values to swap.
+ * @param nBytes Number of bytes of values.
+ * @param shuffle The byte shuffle which swaps each value in 16 bytes.
+ *
+ * @return The number of bytes swapped, which is nBytes rounded down to a multiple of 32.
+ */
+HAPPLY_SIMD_TARGET("avx2")
+inline size_t swapEndianAVX2(char* bytes, size_t nBytes, const char* shuffle) {
+  // The shuffle works within each 16 byte lane, so the same one is used for both
+  __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(shuffle)));
+  size_t i = 0;
+  for (; i + 32 <= nBytes; i += 32) {
+    __m256i vals = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(bytes + i), _mm256_shuffle_epi8(vals, mask));
   }
+  return i;
+}
 
-  // = Unsigned int
+/**
+ * The best vector instructions supported by this processor: 2 for AVX2, 1 for SSSE3, or 0 for neither.
+ */
+inline int simdLevel() {
+#if defined(HAPPLY_SIMD_DISPATCH)
+  static const int level = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? 2 : (__builtin_cpu_supports("ssse3") ? 1 : 0);
+  }();
+  return level;
+#else
+  return 2;
+#endif
+}
 
-  // 8 bit unsigned
-  if (typeStr == "uchar" || typeStr == "uint8") {
-    if (isList) {
-      return std::unique_ptr<Property>(new TypedListProperty<uint8_t>(name, listCountBytes));
-    } else {
-      return std::unique_ptr<Property>(new TypedProperty<uint8_t>(name));
+#endif
+
+/**
+ * Swap the endianness of many values in place. This is much faster than calling swapEndian() on each value, as
+ * vector instructions are used where the processor supports them.
+ *
+ * @param data The values to swap.
+ * @param count Number of values.
+ */
+template <typename T>
+void swapEndianBatch(T* data, size_t count) {
+  if (sizeof(T) == 1) return;
+  size_t iStart = 0;
+
+#if defined(HAPPLY_SIMD_TARGET)
+  if (sizeof(T) <= 8 && count * sizeof(T) >= 16) {
+    // Shuffle which reverses the bytes of each value in 16 bytes
+    char shuffle[16];
+    for (size_t i = 0; i < 16; i++) {
+      shuffle[i] = static_cast<char>(i / sizeof(T) * sizeof(T) + (sizeof(T) - 1 - i % sizeof(T)));
     }
+
+    char* bytes = reinterpret_cast<char*>(data);
+    size_t nBytes = count * sizeof(T);
+    size_t nSwapped = 0;
+    int level = simdLevel();
+    if (level >= 2) nSwapped = swapEndianAVX2(bytes, nBytes, shuffle);
+    if (level >= 1) nSwapped += swapEndianSSSE3(bytes + nSwapped, nBytes - nSwapped, shuffle);
+    iStart = nSwapped / sizeof(T);
+  }
+#endif
+
+  // Copy the leftover values in and out, so this is also safe for storage which really holds some other type
+  char* bytes = reinterpret_cast<char*>(data);
+  for (size_t i = iStart; i < count; i++) {
+    T val;
+    std::memcpy(&val, bytes + i * sizeof(T), sizeof(T));
+    val = swapEndian(val);
+    std::memcpy(bytes + i * sizeof(T), &val, sizeof(T));
   }
+}
 
-  // 16 bit unsigned
-  else if (typeStr == "ushort" || typeStr == "uint16") {
-    if (isList) {
-      return std::unique_ptr<Property>(new TypedListProperty<uint16_t>(name, listCountBytes));
-    } else {
-      return std::unique_ptr<Property>(new TypedProperty<uint16_t>(name));
-    }
+/**
+ * Swap the endianness of many values in place, given only the width of each value.
+ *
+ * @param bytes The values to swap.
+ * @param count Number of values.
+ * @param width Number of bytes in each value.
+ */
+inline void swapEndianBytes(char* bytes, size_t count, size_t width) {
+  switch (width) {
+  case 2:
+    swapEndianBatch(reinterpret_cast<uint16_t*>(bytes), count);
+    break;
+  case 4:
+    swapEndianBatch(reinterpret_cast<uint32_t*>(bytes), count);
+    break;
+  case 8:
+    swapEndianBatch(reinterpret_cast<uint64_t*>(bytes), count);
+    break;
+  default:
+    break;
   }
+}
 
-  // 32 bit unsigned
-  else if (typeStr == "uint" || typeStr == "uint32") {
-    if (isList) {
-      return std::unique_ptr<Property>(new TypedListProperty<uint32_t>(name, listCountBytes));
-    } else {
-      return std::unique_ptr<Property>(new TypedProperty<uint32_t>(name));
-    }
+/**
+ * Swap the endianness of many values in place, which are spaced out in memory.
+ *
+ * @param bytes The first value.
+ * @param count Number of values.
+ * @param width Number of bytes in each value.
+ * @param stride Number of bytes from the start of one value to the start of the next.
+ */
+inline void swapEndianStrided(char* bytes, size_t count, size_t width, size_t stride) {
+  if (stride == width) {
+    swapEndianBytes(bytes, count, width);
+    return;
   }
+  for (size_t i = 0; i < count; i++) {
+    std::reverse(bytes + i * stride, bytes + i * stride + width);
+  }
+}
 
-  // = Signed int
 
-  // 8 bit signed
-  if (typeStr == "char" || typeStr == "int8") {
-    if (isList) {
-      return std::unique_ptr<Property>(new TypedListProperty<int8_t>(name, listCountBytes));
-    } else {
-      return std::unique_ptr<Property>(new TypedProperty<int8_t>(name));
+/**
+ * Copy N byte values to spaced out places, optionally swapping their endianness on the way. Neither side need be
+ * aligned.
+ */
+template <size_t N>
+void scatterValues(char* dst, const char* src, size_t count, size_t dstStride, bool swap) {
+  char value[N];
+  if (swap) {
+    for (size_t i = 0; i < count; i++) {
+      std::memcpy(value, src + i * N, N);
+      std::reverse(value, value + N);
+      std::memcpy(dst + i * dstStride, value, N);
     }
-  }
-
-  // 16 bit signed
-  else if (typeStr == "short" || typeStr == "int16") {
-    if (isList) {
-      return std::unique_ptr<Property>(new TypedListProperty<int16_t>(name, listCountBytes));
-    } else {
-      return std::unique_ptr<Property>(new TypedProperty<int16_t>(name));
+  } else {
+    for (size_t i = 0; i < count; i++) {
+      std::memcpy(dst + i * dstStride, src + i * N, N);
     }
   }
+}
 
-  // 32 bit signed
-  else if (typeStr == "int" || typeStr == "int32") {
-    if (isList) {
-      return std::unique_ptr<Property>(new TypedListProperty<int32_t>(name, listCountBytes));
-    } else {
-      return std::unique_ptr<Property>(new TypedProperty<int32_t>(name));
+/**
+ * Copy packed values to spaced out places, optionally swapping their endianness on the way.
+ *
+ * @param dst Where the first value goes.
+ * @param src The packed values.
+ * @param count Number of values.
+ * @param width Number of bytes in each value.
+ * @param dstStride Number of bytes from the start of one value to the start of the next in dst.
+ * @param swap Whether to swap endianness.
+ */
+inline void scatterValues(char* dst, const char* src, size_t count, size_t width, size_t dstStride, bool swap) {
+  switch (width) {
+  case 1:
+    scatterValues<1>(dst, src, count, dstStride, false);
+    break;
+  case 2:
+    scatterValues<2>(dst, src, count, dstStride, swap);
+    break;
+  case 4:
+    scatterValues<4>(dst, src, count, dstStride, swap);
+    break;
+  case 8:
+    scatterValues<8>(dst, src, count, dstStride, swap);
+    break;
+  default:
+    for (size_t i = 0; i < count; i++) {
+      std::memcpy(dst + i * dstStride, src + i * width, width);
+      if (swap) std::reverse(dst + i * dstStride, dst + i * dstStride + width);
     }
   }
+}
 
-  // = Float
 
-  // 32 bit float
-  else if (typeStr == "float" || typeStr == "float32") {
-    if (isList) {
-      return std::unique_ptr<Property>(new TypedListProperty<float>(name, listCountBytes));
-    } else {
-      return std::unique_ptr<Property>(new TypedProperty<float>(name));
-    }
+// Unpack flattened list from the convention used in TypedListProperty
+template <typename T>
+std::vector<std::vector<T>> unflattenList(const std::vector<T>& flatList, const std::vector<size_t> flatListStarts) {
+  size_t outerCount = flatListStarts.size() - 1;
+
+  // Put the output here
+  std::vector<std::vector<T>> outLists(outerCount);
+
+  if (outerCount == 0) {
+    return outLists; // quick out for empty
   }
 
-  // 64 bit float
-  else if (typeStr == "double" || typeStr == "float64") {
-    if (isList) {
-      return std::unique_ptr<Property>(new TypedListProperty<double>(name, listCountBytes));
-    } else {
-      return std::unique_ptr<Property>(new TypedProperty<double>(name));
-    }
+  // Copy each sublist
+  for (size_t iOuter = 0; iOuter < outerCount; iOuter++) {
+    size_t iFlatStart = flatListStarts[iOuter];
+    size_t iFlatEnd = flatListStarts[iOuter + 1];
+    outLists[iOuter].insert(outLists[iOuter].begin(), flatList.begin() + iFlatStart, flatList.begin() + iFlatEnd);
   }
 
-  else {
-    throw std::runtime_error("Data type: " + typeStr + " cannot be mapped to .ply format");
+  return outLists;
+}
+
+
+/**
+ * Run a function over the range [0, n), split in to one contiguous chunk per thread. Exceptions thrown by the function
+ * are rethrown on the calling thread.
+ *
+ * @param n Size of the range.
+ * @param nThreads Number of threads to use. If 1, the function is run directly on the calling thread.
+ * @param func Function taking (size_t iStart, size_t iEnd) for a chunk.
+ */
+template <typename F>
+void parallelFor(size_t n, size_t nThreads, F func) {
+  nThreads = std::max<size_t>(1, std::min(nThreads, n));
+  if (nThreads == 1) {
+    func(0, n);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  std::vector<std::exception_ptr> errors(nThreads);
+  for (size_t iThread = 0; iThread < nThreads; iThread++) {
+    size_t iStart = n * iThread / nThreads;
+    size_t iEnd = n * (iThread + 1) / nThreads;
+    threads.emplace_back([&func, &errors, iThread, iStart, iEnd]() {
+      try {
+        func(iStart, iEnd);
+      } catch (...) {
+        errors[iThread] = std::current_exception();
+      }
+    });
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  for (std::exception_ptr& e : errors) {
+    if (e) std::rethrow_exception(e);
   }
 }
 
 /**
- * @brief An element (more properly an element type) in the .ply object. Tracks the name of the elemnt type (eg,
- * "vertices"), the number of elements of that type (eg, 1244), and any properties associated with that element (eg,
- * "position", "color").
+ * Resolve a requested number of threads, where 0 means one per hardware thread.
  */
-class Element {
+inline size_t resolveThreadCount(size_t nThreads) {
+  if (nThreads == 0) nThreads = std::thread::hardware_concurrency();
+  return std::max<size_t>(1, nThreads);
+}
+
+
+}; // namespace
+
+
+/**
+ * @brief A property which takes a single value (not a list).
+ */
+template <class T>
+class TypedProperty : public Property {
 
 public:
   /**
-   * @brief Create a new element type.
+   * @brief Create a new Property with the given name.
    *
-   * @param name_ Name of the element type (eg, "vertices")
-   * @param count_ Number of instances of this element.
+   * @param name_
    */
-  Element(const std::string& name_, size_t count_) : name(name_), count(count_) {}
-
-  std::string name;
-  size_t count;
-  std::vector<std::unique_ptr<Property>> properties;
+  TypedProperty(const std::string& name_) : Property(name_) {
+    if (typeName<T>() == "unknown") {
+      // TODO should really be a compile-time error
+      throw std::runtime_error("Attempted property type does not match any type defined by the .ply format.");
+    }
+  };
 
   /**
-   * @brief Check if a property exists.
-   *
-   * @param target The name of the property to get.
+   * @brief Create a new property and initialize with data.
    *
-   * @return Whether the target property exists.
+   * @param name_
+   * @param data_
    */
-  bool hasProperty(const std::string& target) {
-    for (std::unique_ptr<Property>& prop : properties) {
-      if (prop->name == target) {
-        return true;
-      }
+  TypedProperty(const std::string& name_, const std::vector<T>& data_) : Property(name_), data(data_) {
+    if (typeName<T>() == "unknown") {
+      throw std::runtime_error("Attempted property type does not match any type defined by the .ply format.");
     }
-    return false;
-  }
+  };
+
+  virtual ~TypedProperty() override{};
 
   /**
-   * @brief Check if a property exists with the requested type.
-   *
-   * @tparam T The type of the property
-   * @param target The name of the property to get.
+   * @brief Create a new property with the same name and type as this one, but no data.
    *
-   * @return Whether the target property exists.
+   * @return The new property.
    */
-  template <class T>
-  bool hasPropertyType(const std::string& target) {
-    for (std::unique_ptr<Property>& prop : properties) {
-      if (prop->name == target) {
-        TypedProperty<T>* castedProp = dynamic_cast<TypedProperty<T>*>(prop.get());
-        if (castedProp) {
-          return true;
-        }
-        return false;
-      }
-    }
-    return false;
+  virtual std::unique_ptr<Property> emptyCopy() override {
+    return std::unique_ptr<Property>(new TypedProperty<T>(name));
   }
 
   /**
-   * @brief A list of the names of all properties
+   * @brief Reserve memory.
    *
-   * @return Property names
+   * @param capacity Expected number of elements.
    */
-  std::vector<std::string> getPropertyNames() {
-    std::vector<std::string> names;
-    for (std::unique_ptr<Property>& p : properties) {
-      names.push_back(p->name);
-    }
-    return names;
-  }
+  virtual void reserve(size_t capacity) override { data.reserve(capacity); }
 
   /**
-   * @brief Low-level method to get a pointer to a property. Users probably don't need to call this.
-   *
-   * @param target The name of the property to get.
+   * @brief Set the number of element entries for this property.
    *
-   * @return A (unique_ptr) pointer to the property.
+   * @param count New number of entries.
    */
-  std::unique_ptr<Property>& getPropertyPtr(const std::string& target) {
-    for (std::unique_ptr<Property>& prop : properties) {
-      if (prop->name == target) {
-        return prop;
-      }
-    }
-    throw std::runtime_error("PLY parser: element " + name + " does not have property " + target);
-  }
+  virtual void resize(size_t count) override { data.resize(count); }
 
   /**
-   * @brief Add a new (plain, not list) property for this element type.
+   * @brief (ASCII reading) Parse out the next value of this property from the tokens of a line.
    *
-   * @tparam T The type of the property
-   * @param propertyName The name of the property
-   * @param data The data for the property. Must have the same length as the number of elements.
+   * @param tokens The tokens of the element's line, positioned at this property.
    */
-  template <class T>
-  void addProperty(const std::string& propertyName, const std::vector<T>& data) {
-
-    if (data.size() != count) {
-      throw std::runtime_error("PLY write: new property " + propertyName + " has size which does not match element");
-    }
+  virtual void parseNext(ASCIITokenizer& tokens) override { data.push_back(tokens.next<T>(name)); };
 
-    // If there is already some property with this name, remove it
-    for (size_t i = 0; i < properties.size(); i++) {
-      if (properties[i]->name == propertyName) {
-        properties.erase(properties.begin() + i);
-        i--;
-      }
-    }
+  /**
+   * @brief (binary reading) The number of bytes this property occupies in every record.
+   *
+   * @return The width in bytes.
+   */
+  virtual size_t fixedByteWidth() override { return sizeof(T); }
 
-    // Copy to canonical type. Often a no-op, but takes care of standardizing widths across platforms.
-    std::vector<typename CanonicalName<T>::type> canonicalVec(data.begin(), data.end());
+  /**
+   * @brief (binary reading) The number of bytes occupied by one entry of this property.
+   *
+   * @return The width in bytes.
+   */
+  virtual size_t entryByteWidth(const char* entry, const char* end, bool bigEndian) override { return sizeof(T); }
 
-    properties.push_back(
-        std::unique_ptr<Property>(new TypedProperty<typename CanonicalName<T>::type>(propertyName, canonicalVec)));
-  }
+  /**
+   * @brief (binary reading) The number of bytes in each value of this property.
+   *
+   * @return The width in bytes.
+   */
+  virtual size_t valueByteWidth() override { return sizeof(T); }
 
   /**
-   * @brief Add a new list property for this element type.
+   * @brief (binary reading) This property is not a list, so this is always 0.
    *
-   * @tparam T The type of the property (eg, "double" for a list of doubles)
-   * @param propertyName The name of the property
-   * @param data The data for the property. Outer vector must have the same length as the number of elements.
+   * @return 0
    */
-  template <class T>
-  void addListProperty(const std::string& propertyName, const std::vector<std::vector<T>>& data) {
+  virtual size_t listCountByteWidth() override { return 0; }
 
-    if (data.size() != count) {
-      throw std::runtime_error("PLY write: new property " + propertyName + " has size which does not match element");
-    }
+  /**
+   * @brief (binary reading) Raw pointer to data.
+   *
+   * @return The pointer.
+   */
+  virtual char* valueStorage() override { return reinterpret_cast<char*>(data.data()); }
 
-    // If there is already some property with this name, remove it
-    for (size_t i = 0; i < properties.size(); i++) {
-      if (properties[i]->name == propertyName) {
-        properties.erase(properties.begin() + i);
-        i--;
-      }
-    }
+  /**
+   * @brief (binary reading) This property is not a list, so this is always null.
+   *
+   * @return nullptr
+   */
+  virtual size_t* listStartStorage() override { return nullptr; }
 
-    // Copy to canonical type. Often a no-op, but takes care of standardizing widths across platforms.
-    std::vector<std::vector<typename CanonicalName<T>::type>> canonicalListVec;
-    for (const std::vector<T>& subList : data) {
-      canonicalListVec.emplace_back(subList.begin(), subList.end());
-    }
+  /**
+   * @brief Set the total number of values stored by this property, which is the same as the number of entries.
+   *
+   * @param nValues New number of values.
+   */
+  virtual void resizeValues(size_t nValues) override { data.resize(nValues); }
 
-    properties.push_back(std::unique_ptr<Property>(
-        new TypedListProperty<typename CanonicalName<T>::type>(propertyName, canonicalListVec)));
+  /**
+   * @brief (reading) Write a header entry for this property.
+   *
+   * @param outStream Stream to write to.
+   */
+  virtual void writeHeader(std::ostream& outStream) override {
+    outStream << "property " << typeName<T>() << " " << name << "\n";
   }
 
   /**
-   * @brief Get a vector of a data from a property for this element. Automatically promotes to larger types. Throws if
-   * requested data is unavailable.
-   *
-   * @tparam T The type of data requested
-   * @param propertyName The name of the property to get.
+   * @brief (ASCII writing) write this property for some element in plaintext
    *
-   * @return The data.
+   * @param out Writer to format the text with.
+   * @param iElement index of the element to write.
    */
-  template <class T>
-  std::vector<T> getProperty(const std::string& propertyName) {
-
-    // Find the property
-    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
-
-    // Get a copy of the data with auto-promoting type magic
-    return getDataFromPropertyRecursive<T, T>(prop.get());
-  }
+  virtual void writeDataASCII(ASCIIWriter& out, size_t iElement) override { out.write(data[iElement]); }
 
   /**
-   * @brief Get a vector of a data from a property for this element. Unlike getProperty(), only returns if the ply
-   * record contains a type that matches T exactly. Throws if * requested data is unavailable.
-   *
-   * @tparam T The type of data requested
-   * @param propertyName The name of the property to get.
+   * @brief Number of element entries for this property
    *
-   * @return The data.
+   * @return
    */
-  template <class T>
-  std::vector<T> getPropertyType(const std::string& propertyName) {
-
-    // Find the property
-    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
-    TypedProperty<T>* castedProp = dynamic_cast<TypedProperty<T>*>(prop.get());
-    if (castedProp) {
-      return castedProp->data;
-    }
+  virtual size_t size() override { return data.size(); }
 
-    // No match, failure
-    throw std::runtime_error("PLY parser: property " + prop->name + " is not of type type " + typeName<T>() +
-                             ". Has type " + prop->propertyTypeName());
-  }
 
   /**
-   * @brief Get a vector of lists of data from a property for this element. Automatically promotes to larger types.
-   * Throws if requested data is unavailable.
-   *
-   * @tparam T The type of data requested
-   * @param propertyName The name of the property to get.
+   * @brief A string naming the type of the property
    *
-   * @return The data.
+   * @return
    */
-  template <class T>
-  std::vector<std::vector<T>> getListProperty(const std::string& propertyName) {
+  virtual std::string propertyTypeName() override { return typeName<T>(); }
 
-    // Find the property
-    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
+  /**
+   * @brief The actual data contained in the property
+   */
+  std::vector<T> data;
+};
 
-    // Get a copy of the data with auto-promoting type magic
-    return getDataFromListPropertyRecursive<T, T>(prop.get());
-  }
 
+/**
+ * @brief A property which is a list of value (eg, 3 doubles). Note that lists are always variable length per-element.
+ */
+template <class T>
+class TypedListProperty : public Property {
+
+public:
   /**
-   * @brief Get a vector of a data from a property for this element. Unlike getProperty(), only returns if the ply
-   * record contains a type that matches T exactly. Throws if * requested data is unavailable.
-   *
-   * @tparam T The type of data requested
-   * @param propertyName The name of the property to get.
+   * @brief Create a new Property with the given name.
    *
-   * @return The data.
+   * @param name_
    */
-  template <class T>
-  std::vector<std::vector<T>> getListPropertyType(const std::string& propertyName) {
-
-    // Find the property
-    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
-    TypedListProperty<T>* castedProp = dynamic_cast<TypedListProperty<T>*>(prop.get());
-    if (castedProp) {
-      return unflattenList(castedProp->flattenedData, castedProp->flattenedIndexStart);
+  TypedListProperty(const std::string& name_, int listCountBytes_) : Property(name_), listCountBytes(listCountBytes_) {
+    if (typeName<T>() == "unknown") {
+      throw std::runtime_error("Attempted property type does not match any type defined by the .ply format.");
     }
 
-    // No match, failure
-    throw std::runtime_error("PLY parser: list property " + prop->name + " is not of type " + typeName<T>() +
-                             ". Has type " + prop->propertyTypeName());
-  }
-
+    flattenedIndexStart.push_back(0);
+  };
 
   /**
-   * @brief Get a vector of lists of data from a property for this element. Automatically promotes to larger types.
-   * Unlike getListProperty(), this method will additionally convert between types of different sign (eg, requesting and
-   * int32 would get data from a uint32); doing so naively converts between signed and unsigned types. This is typically
-   * useful for data representing indices, which might be stored as signed or unsigned numbers.
-   *
-   * @tparam T The type of data requested
-   * @param propertyName The name of the property to get.
+   * @brief Create a new property and initialize with data
    *
-   * @return The data.
+   * @param name_
+   * @param data_
    */
-  template <class T>
-  std::vector<std::vector<T>> getListPropertyAnySign(const std::string& propertyName) {
-
-    // Find the property
-    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
-
-    // Get a copy of the data with auto-promoting type magic
-    try {
-      // First, try the usual approach, looking for a version of the property with the same signed-ness and possibly
-      // smaller size
-      return getDataFromListPropertyRecursive<T, T>(prop.get());
-    } catch (const std::runtime_error& orig_e) {
-
-      // If the usual approach fails, look for a version with opposite signed-ness
-      try {
+  TypedListProperty(const std::string& name_, const std::vector<std::vector<T>>& data_) : Property(name_) {
+    if (typeName<T>() == "unknown") {
+      throw std::runtime_error("Attempted property type does not match any type defined by the .ply format.");
+    }
 
-        // This type has the oppopsite signeness as the input type
-        typedef typename CanonicalName<T>::type Tcan;
-        typedef typename std::conditional<std::is_signed<Tcan>::value, typename std::make_unsigned<Tcan>::type,
-                                          typename std::make_signed<Tcan>::type>::type OppsignType;
+    // Populate list with data
+    flattenedIndexStart.push_back(0);
+    for (const std::vector<T>& vec : data_) {
+      for (const T& val : vec) {
+        flattenedData.emplace_back(val);
+      }
+      flattenedIndexStart.push_back(flattenedData.size());
+    }
+  };
 
-        return getDataFromListPropertyRecursive<T, OppsignType>(prop.get());
+  virtual ~TypedListProperty() override{};
 
-      } catch (const std::runtime_error&) {
-        throw orig_e;
-      }
+  /**
+   * @brief Create a new property with the same name, type and list count width as this one, but no data.
+   *
+   * @return The new property.
+   */
+  virtual std::unique_ptr<Property> emptyCopy() override {
+    return std::unique_ptr<Property>(new TypedListProperty<T>(name, listCountBytes));
+  }
 
-      throw orig_e;
-    }
+  /**
+   * @brief Reserve memory.
+   *
+   * @param capacity Expected number of elements.
+   */
+  virtual void reserve(size_t capacity) override {
+    flattenedData.reserve(3 * capacity); // optimize for triangle meshes
+    flattenedIndexStart.reserve(capacity + 1);
   }
 
+  /**
+   * @brief Set the number of element entries for this property. Only flattenedIndexStart is resized; any new entries
+   * must be filled in, and flattenedData sized to match, before the property is used.
+   *
+   * @param count New number of entries.
+   */
+  virtual void resize(size_t count) override { flattenedIndexStart.resize(count + 1); }
 
   /**
-   * @brief Performs sanity checks on the element, throwing if any fail.
+   * @brief (ASCII reading) Parse out the next value of this property from the tokens of a line.
+   *
+   * @param tokens The tokens of the element's line, positioned at this property.
    */
-  void validate() {
+  virtual void parseNext(ASCIITokenizer& tokens) override {
 
-    // Make sure no properties have duplicate names, and no names have whitespace
-    for (size_t iP = 0; iP < properties.size(); iP++) {
-      for (char c : properties[iP]->name) {
-        if (std::isspace(c)) {
-          throw std::runtime_error("Ply validate: illegal whitespace in name " + properties[iP]->name);
-        }
-      }
-      for (size_t jP = iP + 1; jP < properties.size(); jP++) {
-        if (properties[iP]->name == properties[jP]->name) {
-          throw std::runtime_error("Ply validate: multiple properties with name " + properties[iP]->name);
-        }
-      }
+    size_t count = tokens.next<size_t>(name);
+    if (count > tokens.maxTokensLeft()) {
+      throw std::runtime_error("PLY parser: list property " + name + " has fewer values than its count");
     }
 
-    // Make sure all properties have right length
-    for (size_t iP = 0; iP < properties.size(); iP++) {
-      if (properties[iP]->size() != count) {
-        throw std::runtime_error("Ply validate: property has wrong size. " + properties[iP]->name +
-                                 " does not match element size.");
-      }
+    size_t currSize = flattenedData.size();
+    size_t afterSize = currSize + count;
+    flattenedData.resize(afterSize);
+    for (size_t iFlat = currSize; iFlat < afterSize; iFlat++) {
+      flattenedData[iFlat] = tokens.next<T>(name);
     }
+    flattenedIndexStart.emplace_back(afterSize);
   }
 
   /**
-   * @brief Writes out this element's information to the file header.
+   * @brief (binary reading) List properties have a different width in each record, so this is always 0.
    *
-   * @param outStream The stream to use.
+   * @return 0
    */
-  void writeHeader(std::ostream& outStream) {
-
-    outStream << "element " << name << " " << count << "\n";
-
-    for (std::unique_ptr<Property>& p : properties) {
-      p->writeHeader(outStream);
-    }
-  }
+  virtual size_t fixedByteWidth() override { return 0; }
 
   /**
-   * @brief (ASCII writing) Writes out all of the data for every element of this element type to the stream, including
-   * all contained properties.
+   * @brief (binary reading) The number of bytes occupied by one entry of this property, including the list count.
    *
-   * @param outStream The stream to write to.
+   * @param entry Pointer to the start of the entry.
+   * @param end End of the available bytes.
+   * @param bigEndian Is the data stored big endian?
+   *
+   * @return The width of the entry in bytes, or 0 if the list count is not available.
    */
-  void writeDataASCII(std::ostream& outStream) {
-    // Question: what is the proper output for an element with no properties? Here, we write a blank line, so there is
-    // one line per element no matter what.
-    for (size_t iE = 0; iE < count; iE++) {
-      for (size_t iP = 0; iP < properties.size(); iP++) {
-        properties[iP]->writeDataASCII(outStream, iE);
-        if (iP < properties.size() - 1) {
-          outStream << " ";
-        }
-      }
-      outStream << "\n";
-    }
+  virtual size_t entryByteWidth(const char* entry, const char* end, bool bigEndian) override {
+    if (end - entry < listCountBytes) return 0;
+    return listCountBytes + readListCount(entry, bigEndian) * sizeof(T);
   }
 
+  /**
+   * @brief (binary reading) The number of bytes in each value of the lists.
+   *
+   * @return The width in bytes.
+   */
+  virtual size_t valueByteWidth() override { return sizeof(T); }
 
   /**
-   * @brief (binary writing) Writes out all of the data for every element of this element type to the stream, including
-   * all contained properties.
+   * @brief (binary reading) The number of bytes in the count which precedes each list.
    *
-   * @param outStream The stream to write to.
+   * @return The width in bytes.
    */
-  void writeDataBinary(std::ostream& outStream) {
-    for (size_t iE = 0; iE < count; iE++) {
-      for (size_t iP = 0; iP < properties.size(); iP++) {
-        properties[iP]->writeDataBinary(outStream, iE);
-      }
-    }
-  }
+  virtual size_t listCountByteWidth() override { return listCountBytes; }
 
+  /**
+   * @brief (binary reading) Raw pointer to flattenedData.
+   *
+   * @return The pointer.
+   */
+  virtual char* valueStorage() override { return reinterpret_cast<char*>(flattenedData.data()); }
 
   /**
-   * @brief (binary writing) Writes out all of the data for every element of this element type to the stream, including
-   * all contained properties.
+   * @brief (binary reading) Raw pointer to flattenedIndexStart.
    *
-   * @param outStream The stream to write to.
+   * @return The pointer.
    */
-  void writeDataBinaryBigEndian(std::ostream& outStream) {
-    for (size_t iE = 0; iE < count; iE++) {
-      for (size_t iP = 0; iP < properties.size(); iP++) {
-        properties[iP]->writeDataBinaryBigEndian(outStream, iE);
-      }
-    }
-  }
+  virtual size_t* listStartStorage() override { return flattenedIndexStart.data(); }
 
+  /**
+   * @brief Set the total number of values stored by this property, which is the size of flattenedData.
+   *
+   * @param nValues New number of values.
+   */
+  virtual void resizeValues(size_t nValues) override { flattenedData.resize(nValues); }
 
   /**
-   * @brief Helper function which does the hard work to implement type promotion for data getters. Throws if type
-   * conversion fails.
+   * @brief (binary reading) Decode a list count field.
    *
-   * @tparam D The desired output type
-   * @tparam T The current attempt for the actual type of the property
-   * @param prop The property to get (does not delete nor share pointer)
+   * @param entry Pointer to the count field.
+   * @param bigEndian Is the data stored big endian?
    *
-   * @return The data, with the requested type
+   * @return The number of entries in the list.
    */
-  template <class D, class T>
-  std::vector<D> getDataFromPropertyRecursive(Property* prop) {
-
-    typedef typename CanonicalName<T>::type Tcan;
-
-    { // Try to return data of type D from a property of type T
-      TypedProperty<Tcan>* castedProp = dynamic_cast<TypedProperty<Tcan>*>(prop);
-      if (castedProp) {
-        // Succeeded, return a buffer of the data (copy while converting type)
-        std::vector<D> castedVec;
-        castedVec.reserve(castedProp->data.size());
-        for (Tcan& v : castedProp->data) {
-          castedVec.push_back(static_cast<D>(v));
-        }
-        return castedVec;
-      }
-    }
-
-    TypeChain<Tcan> chainType;
-    if (chainType.hasChildType) {
-      return getDataFromPropertyRecursive<D, typename TypeChain<Tcan>::type>(prop);
-    } else {
-      // No smaller type to try, failure
-      throw std::runtime_error("PLY parser: property " + prop->name + " cannot be coerced to requested type " +
-                               typeName<D>() + ". Has type " + prop->propertyTypeName());
+  size_t readListCount(const char* entry, bool bigEndian) {
+    // Note: the count is always parsed as if unsigned, see createPropertyWithType()
+    size_t count = 0;
+    if (listCountBytes == 1) {
+      uint8_t c;
+      std::memcpy(&c, entry, 1);
+      count = c;
+    } else if (listCountBytes == 2) {
+      uint16_t c;
+      std::memcpy(&c, entry, 2);
+      count = bigEndian ? swapEndian(c) : c;
+    } else if (listCountBytes == 4) {
+      uint32_t c;
+      std::memcpy(&c, entry, 4);
+      count = bigEndian ? swapEndian(c) : c;
     }
+    return count;
   }
 
-
   /**
-   * @brief Helper function which does the hard work to implement type promotion for list data getters. Throws if type
-   * conversion fails.
+   * @brief (reading) Write a header entry for this property. Note that we already use "uchar" for the list count type.
    *
-   * @tparam D The desired output type
+   * @param outStream Stream to write to.
+   */
+  virtual void writeHeader(std::ostream& outStream) override {
+    // NOTE: We ALWAYS use uchar as the list count output type
+    outStream << "property list uchar " << typeName<T>() << " " << name << "\n";
+  }
+
+  /**
+   * @brief (ASCII writing) write this property for some element in plaintext
+   *
+   * @param out Writer to format the text with.
+   * @param iElement index of the element to write.
+   */
+  virtual void writeDataASCII(ASCIIWriter& out, size_t iElement) override {
+    size_t dataStart = flattenedIndexStart[iElement];
+    size_t dataEnd = flattenedIndexStart[iElement + 1];
+
+    // Get the number of list elements as a uchar, and ensure the value fits
+    size_t dataCount = dataEnd - dataStart;
+    if (dataCount > std::numeric_limits<uint8_t>::max()) {
+      throw std::runtime_error(
+          "List property has an element with more entries than fit in a uchar. See note in README.");
+    }
+
+    out.write(dataCount);
+    for (size_t iFlat = dataStart; iFlat < dataEnd; iFlat++) {
+      out.put(' ');
+      out.write(flattenedData[iFlat]);
+    }
+  }
+
+  /**
+   * @brief Number of element entries for this property
+   *
+   * @return
+   */
+  virtual size_t size() override { return flattenedIndexStart.size() - 1; }
+
+
+  /**
+   * @brief A string naming the type of the property
+   *
+   * @return
+   */
+  virtual std::string propertyTypeName() override { return typeName<T>(); }
+
+  /**
+   * @brief The (flattened) data for the property, as formed by concatenating all of the individual element lists
+   * together.
+   */
+  std::vector<T> flattenedData;
+
+  /**
+   * @brief Indices in to flattenedData. The i'th element gives the index in to flattenedData where the element's data
+   * begins. A final entry is included which is the length of flattenedData. Size is N_elem + 1.
+   */
+  std::vector<size_t> flattenedIndexStart;
+
+  /**
+   * @brief The number of bytes used to store the count for lists of data.
+   */
+  int listCountBytes = -1;
+};
+
+
+/**
+ * @brief Helper function to construct a new property of the appropriate type.
+ *
+ * @param name The name of the property to construct.
+ * @param typeStr A string naming the type according to the format.
+ * @param isList Is this a plain property, or a list property?
+ * @param listCountTypeStr If a list property, the type of the count varible.
+ *
+ * @return A new Property with the proper type.
+ */
+inline std::unique_ptr<Property> createPropertyWithType(const std::string& name, const std::string& typeStr,
+                                                        bool isList, const std::string& listCountTypeStr) {
+
+  // == Figure out how many bytes the list count field has, if this is a list type
+  // Note: some files seem to use signed types here, we read the width but always parse as if unsigned
+  int listCountBytes = -1;
+  if (isList) {
+    if (listCountTypeStr == "uchar" || listCountTypeStr == "uint8" || listCountTypeStr == "char" ||
+        listCountTypeStr == "int8") {
+      listCountBytes = 1;
+    } else if (listCountTypeStr == "ushort" || listCountTypeStr == "uint16" || listCountTypeStr == "short" ||
+               listCountTypeStr == "int16") {
+      listCountBytes = 2;
+    } else if (listCountTypeStr == "uint" || listCountTypeStr == "uint32" || listCountTypeStr == "int" ||
+               listCountTypeStr == "int32") {
+      listCountBytes = 4;
+    } else {
+      throw std::runtime_error("Unrecognized list count type: " + listCountTypeStr);
+    }
+  }
+
+  // = Unsigned int
+
+  // 8 bit unsigned
+  if (typeStr == "uchar" || typeStr == "uint8") {
+    if (isList) {
+      return std::unique_ptr<Property>(new TypedListProperty<uint8_t>(name, listCountBytes));
+    } else {
+      return std::unique_ptr<Property>(new TypedProperty<uint8_t>(name));
+    }
+  }
+
+  // 16 bit unsigned
+  else if (typeStr == "ushort" || typeStr == "uint16") {
+    if (isList) {
+      return std::unique_ptr<Property>(new TypedListProperty<uint16_t>(name, listCountBytes));
+    } else {
+      return std::unique_ptr<Property>(new TypedProperty<uint16_t>(name));
+    }
+  }
+
+  // 32 bit unsigned
+  else if (typeStr == "uint" || typeStr == "uint32") {
+    if (isList) {
+      return std::unique_ptr<Property>(new TypedListProperty<uint32_t>(name, listCountBytes));
+    } else {
+      return std::unique_ptr<Property>(new TypedProperty<uint32_t>(name));
+    }
+  }
+
+  // = Signed int
+
+  // 8 bit signed
+  if (typeStr == "char" || typeStr == "int8") {
+    if (isList) {
+      return std::unique_ptr<Property>(new TypedListProperty<int8_t>(name, listCountBytes));
+    } else {
+      return std::unique_ptr<Property>(new TypedProperty<int8_t>(name));
+    }
+  }
+
+  // 16 bit signed
+  else if (typeStr == "short" || typeStr == "int16") {
+    if (isList) {
+      return std::unique_ptr<Property>(new TypedListProperty<int16_t>(name, listCountBytes));
+    } else {
+      return std::unique_ptr<Property>(new TypedProperty<int16_t>(name));
+    }
+  }
+
+  // 32 bit signed
+  else if (typeStr == "int" || typeStr == "int32") {
+    if (isList) {
+      return std::unique_ptr<Property>(new TypedListProperty<int32_t>(name, listCountBytes));
+    } else {
+      return std::unique_ptr<Property>(new TypedProperty<int32_t>(name));
+    }
+  }
+
+  // = Float
+
+  // 32 bit float
+  else if (typeStr == "float" || typeStr == "float32") {
+    if (isList) {
+      return std::unique_ptr<Property>(new TypedListProperty<float>(name, listCountBytes));
+    } else {
+      return std::unique_ptr<Property>(new TypedProperty<float>(name));
+    }
+  }
+
+  // 64 bit float
+  else if (typeStr == "double" || typeStr == "float64") {
+    if (isList) {
+      return std::unique_ptr<Property>(new TypedListProperty<double>(name, listCountBytes));
+    } else {
+      return std::unique_ptr<Property>(new TypedProperty<double>(name));
+    }
+  }
+
+  else {
+    throw std::runtime_error("Data type: " + typeStr + " cannot be mapped to .ply format");
+  }
+}
+
+/**
+ * @brief A non-owning view of values stored contiguously somewhere else, such as the data of a property. Only valid as
+ * long as that storage is not changed in size or destroyed.
+ */
+template <class T>
+class DataSpan {
+
+public:
+  /**
+   * @brief Create a new view.
+   *
+   * @param data_ The first value.
+   * @param size_ Number of values.
+   */
+  DataSpan(T* data_ = nullptr, size_t size_ = 0) : values(data_), count(size_) {}
+
+  /**
+   * @brief The first value.
+   */
+  T* data() const { return values; }
+
+  /**
+   * @brief Number of values.
+   */
+  size_t size() const { return count; }
+
+  /**
+   * @brief Whether there are no values.
+   */
+  bool empty() const { return count == 0; }
+
+  /**
+   * @brief A value, which must be in range.
+   *
+   * @param i The index of the value.
+   */
+  T& operator[](size_t i) const { return values[i]; }
+
+  T* begin() const { return values; }
+  T* end() const { return values + count; }
+
+private:
+  T* values;
+  size_t count;
+};
+
+/**
+ * @brief A non-owning view of the lists of a list property in flat (compressed sparse row) form: all of the values back
+ * to back, plus the offset at which each list starts. List i is values [starts[i], starts[i+1]).
+ *
+ * @tparam T The type of the values, const-qualified for a read-only view.
+ */
+template <class T>
+class ListSpan {
+
+public:
+  /**
+   * @brief Create a new view.
+   *
+   * @param data_ All of the values, back to back.
+   * @param starts_ Offset in to data_ where each list begins, plus a final entry which is the number of values.
+   * @param size_ Number of lists (one less than the number of entries in starts_).
+   */
+  ListSpan(T* data_ = nullptr, const size_t* starts_ = nullptr, size_t size_ = 0)
+      : values(data_), listStarts(starts_), count(size_) {}
+
+  /**
+   * @brief Number of lists.
+   */
+  size_t size() const { return count; }
+
+  /**
+   * @brief Whether there are no lists.
+   */
+  bool empty() const { return count == 0; }
+
+  /**
+   * @brief A list, which must be in range.
+   *
+   * @param i The index of the list.
+   */
+  DataSpan<T> operator[](size_t i) const {
+    return DataSpan<T>(values + listStarts[i], listStarts[i + 1] - listStarts[i]);
+  }
+
+  /**
+   * @brief All of the values, back to back.
+   */
+  DataSpan<T> flattenedData() const { return DataSpan<T>(values, count == 0 ? 0 : listStarts[count]); }
+
+  /**
+   * @brief Offset where each list begins, with a final entry which is the number of values. Size is size() + 1 (or 0
+   * for an empty view).
+   */
+  DataSpan<const size_t> flattenedIndexStart() const {
+    return DataSpan<const size_t>(listStarts, count == 0 ? 0 : count + 1);
+  }
+
+private:
+  T* values;
+  const size_t* listStarts;
+  size_t count;
+};
+
+/**
+ * @brief Lists of values in flat (compressed sparse row) form, owning their data. Returned by the list getters which
+ * may need to convert types; see ListSpan for a view which does not copy.
+ *
+ * @tparam T The type of the values.
+ */
+template <class T>
+struct FlatList {
+
+  /**
+   * @brief All of the values, back to back.
+   */
+  std::vector<T> flattenedData;
+
+  /**
+   * @brief Offset in to flattenedData where each list begins, with a final entry which is the length of flattenedData.
+   * Size is the number of lists + 1.
+   */
+  std::vector<size_t> flattenedIndexStart;
+
+  /**
+   * @brief Number of lists.
+   */
+  size_t size() const { return flattenedIndexStart.empty() ? 0 : flattenedIndexStart.size() - 1; }
+
+  /**
+   * @brief A list, which must be in range.
+   *
+   * @param i The index of the list.
+   */
+  DataSpan<const T> operator[](size_t i) const { return view()[i]; }
+
+  /**
+   * @brief A view of the lists. Valid until the vectors are modified.
+   */
+  ListSpan<const T> view() const { return ListSpan<const T>(flattenedData.data(), flattenedIndexStart.data(), size()); }
+};
+
+/**
+ * @brief An element (more properly an element type) in the .ply object. Tracks the name of the elemnt type (eg,
+ * "vertices"), the number of elements of that type (eg, 1244), and any properties associated with that element (eg,
+ * "position", "color").
+ */
+class Element {
+
+public:
+  /**
+   * @brief Create a new element type.
+   *
+   * @param name_ Name of the element type (eg, "vertices")
+   * @param count_ Number of instances of this element.
+   */
+  Element(const std::string& name_, size_t count_) : name(name_), count(count_) {}
+
+  std::string name;
+  size_t count;
+  std::vector<std::unique_ptr<Property>> properties;
+
+  /**
+   * @brief Check if a property exists.
+   *
+   * @param target The name of the property to get.
+   *
+   * @return Whether the target property exists.
+   */
+  bool hasProperty(const std::string& target) {
+    for (std::unique_ptr<Property>& prop : properties) {
+      if (prop->name == target) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Check if a property exists with the requested type.
+   *
+   * @tparam T The type of the property
+   * @param target The name of the property to get.
+   *
+   * @return Whether the target property exists.
+   */
+  template <class T>
+  bool hasPropertyType(const std::string& target) {
+    for (std::unique_ptr<Property>& prop : properties) {
+      if (prop->name == target) {
+        TypedProperty<T>* castedProp = dynamic_cast<TypedProperty<T>*>(prop.get());
+        if (castedProp) {
+          return true;
+        }
+        return false;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief A list of the names of all properties
+   *
+   * @return Property names
+   */
+  std::vector<std::string> getPropertyNames() {
+    std::vector<std::string> names;
+    for (std::unique_ptr<Property>& p : properties) {
+      names.push_back(p->name);
+    }
+    return names;
+  }
+
+  /**
+   * @brief The number of bytes in each record of this element in a binary file, if all records have the same size.
+   *
+   * @return The stride in bytes, or 0 if the element has any list properties (or no properties at all).
+   */
+  size_t fixedStride() {
+    size_t stride = 0;
+    for (std::unique_ptr<Property>& prop : properties) {
+      size_t width = prop->fixedByteWidth();
+      if (width == 0) return 0;
+      stride += width;
+    }
+    return stride;
+  }
+
+  /**
+   * @brief (binary reading) Walk over consecutive binary records of this element without decoding them.
+   *
+   * @param data Start of the first record. Advanced past all of the complete records that were found.
+   * @param end End of the available bytes.
+   * @param maxRecords Stop after this many records.
+   * @param bigEndian Is the data stored big endian?
+   *
+   * @return The number of complete records found.
+   */
+  size_t scanBinaryRecords(const char*& data, const char* end, size_t maxRecords, bool bigEndian) {
+    size_t nRecords = 0;
+    while (nRecords < maxRecords) {
+      const char* pos = data;
+      for (std::unique_ptr<Property>& prop : properties) {
+        size_t width = prop->entryByteWidth(pos, end, bigEndian);
+        if (width == 0 || width > static_cast<size_t>(end - pos)) return nRecords;
+        pos += width;
+      }
+      data = pos;
+      nRecords++;
+    }
+    return nRecords;
+  }
+
+  /**
+   * @brief Low-level method to get a pointer to a property. Users probably don't need to call this.
+   *
+   * @param target The name of the property to get.
+   *
+   * @return A (unique_ptr) pointer to the property.
+   */
+  std::unique_ptr<Property>& getPropertyPtr(const std::string& target) {
+    for (std::unique_ptr<Property>& prop : properties) {
+      if (prop->name == target) {
+        return prop;
+      }
+    }
+    throw std::runtime_error("PLY parser: element " + name + " does not have property " + target);
+  }
+
+  /**
+   * @brief Add a new (plain, not list) property for this element type.
+   *
+   * @tparam T The type of the property
+   * @param propertyName The name of the property
+   * @param data The data for the property. Must have the same length as the number of elements.
+   */
+  template <class T>
+  void addProperty(const std::string& propertyName, const std::vector<T>& data) {
+
+    if (data.size() != count) {
+      throw std::runtime_error("PLY write: new property " + propertyName + " has size which does not match element");
+    }
+
+    // If there is already some property with this name, remove it
+    for (size_t i = 0; i < properties.size(); i++) {
+      if (properties[i]->name == propertyName) {
+        properties.erase(properties.begin() + i);
+        i--;
+      }
+    }
+
+    // Copy to canonical type. Often a no-op, but takes care of standardizing widths across platforms.
+    std::vector<typename CanonicalName<T>::type> canonicalVec(data.begin(), data.end());
+
+    properties.push_back(
+        std::unique_ptr<Property>(new TypedProperty<typename CanonicalName<T>::type>(propertyName, canonicalVec)));
+  }
+
+  /**
+   * @brief Add a new list property for this element type.
+   *
+   * @tparam T The type of the property (eg, "double" for a list of doubles)
+   * @param propertyName The name of the property
+   * @param data The data for the property. Outer vector must have the same length as the number of elements.
+   */
+  template <class T>
+  void addListProperty(const std::string& propertyName, const std::vector<std::vector<T>>& data) {
+
+    if (data.size() != count) {
+      throw std::runtime_error("PLY write: new property " + propertyName + " has size which does not match element");
+    }
+
+    // If there is already some property with this name, remove it
+    for (size_t i = 0; i < properties.size(); i++) {
+      if (properties[i]->name == propertyName) {
+        properties.erase(properties.begin() + i);
+        i--;
+      }
+    }
+
+    // Copy to canonical type. Often a no-op, but takes care of standardizing widths across platforms.
+    std::vector<std::vector<typename CanonicalName<T>::type>> canonicalListVec;
+    for (const std::vector<T>& subList : data) {
+      canonicalListVec.emplace_back(subList.begin(), subList.end());
+    }
+
+    properties.push_back(std::unique_ptr<Property>(
+        new TypedListProperty<typename CanonicalName<T>::type>(propertyName, canonicalListVec)));
+  }
+
+  /**
+   * @brief Get a vector of a data from a property for this element. Automatically promotes to larger types. Throws if
+   * requested data is unavailable.
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return The data.
+   */
+  template <class T>
+  std::vector<T> getProperty(const std::string& propertyName) {
+
+    // Find the property
+    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
+
+    // Get a copy of the data with auto-promoting type magic
+    return getDataFromPropertyRecursive<T, T>(prop.get());
+  }
+
+  /**
+   * @brief Get a vector of a data from a property for this element. Unlike getProperty(), only returns if the ply
+   * record contains a type that matches T exactly. Throws if * requested data is unavailable.
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return The data.
+   */
+  template <class T>
+  std::vector<T> getPropertyType(const std::string& propertyName) {
+    return getTypedProperty<T>(propertyName).data;
+  }
+
+  /**
+   * @brief Get a read-only view of the data of a property for this element, without copying it. Like
+   * getPropertyType(), only succeeds if the property has type T exactly; throws otherwise. The view is valid until the
+   * property is resized, replaced, or removed.
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return A view of the data.
+   */
+  template <class T>
+  DataSpan<const T> getPropertySpan(const std::string& propertyName) {
+    std::vector<T>& data = getTypedProperty<T>(propertyName).data;
+    return DataSpan<const T>(data.data(), data.size());
+  }
+
+  /**
+   * @brief Get a view of the data of a property for this element, without copying it, through which the values can be
+   * changed in place. Otherwise the same as getPropertySpan().
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return A view of the data.
+   */
+  template <class T>
+  DataSpan<T> getMutablePropertySpan(const std::string& propertyName) {
+    std::vector<T>& data = getTypedProperty<T>(propertyName).data;
+    return DataSpan<T>(data.data(), data.size());
+  }
+
+  /**
+   * @brief Get a vector of lists of data from a property for this element. Automatically promotes to larger types.
+   * Throws if requested data is unavailable.
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return The data.
+   */
+  template <class T>
+  std::vector<std::vector<T>> getListProperty(const std::string& propertyName) {
+
+    // Find the property
+    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
+
+    // Get a copy of the data with auto-promoting type magic
+    return getDataFromListPropertyRecursive<T, T>(prop.get());
+  }
+
+  /**
+   * @brief Get a vector of a data from a property for this element. Unlike getProperty(), only returns if the ply
+   * record contains a type that matches T exactly. Throws if * requested data is unavailable.
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return The data.
+   */
+  template <class T>
+  std::vector<std::vector<T>> getListPropertyType(const std::string& propertyName) {
+
+    TypedListProperty<T>& prop = getTypedListProperty<T>(propertyName);
+    return unflattenList(prop.flattenedData, prop.flattenedIndexStart);
+  }
+
+
+  /**
+   * @brief Get a vector of lists of data from a property for this element. Automatically promotes to larger types.
+   * Unlike getListProperty(), this method will additionally convert between types of different sign (eg, requesting and
+   * int32 would get data from a uint32); doing so naively converts between signed and unsigned types. This is typically
+   * useful for data representing indices, which might be stored as signed or unsigned numbers.
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return The data.
+   */
+  template <class T>
+  std::vector<std::vector<T>> getListPropertyAnySign(const std::string& propertyName) {
+
+    // Find the property
+    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
+
+    // Get a copy of the data with auto-promoting type magic
+    try {
+      // First, try the usual approach, looking for a version of the property with the same signed-ness and possibly
+      // smaller size
+      return getDataFromListPropertyRecursive<T, T>(prop.get());
+    } catch (const std::runtime_error& orig_e) {
+
+      // If the usual approach fails, look for a version with opposite signed-ness
+      try {
+
+        // This type has the oppopsite signeness as the input type
+        typedef typename CanonicalName<T>::type Tcan;
+        typedef typename std::conditional<std::is_signed<Tcan>::value, typename std::make_unsigned<Tcan>::type,
+                                          typename std::make_signed<Tcan>::type>::type OppsignType;
+
+        return getDataFromListPropertyRecursive<T, OppsignType>(prop.get());
+
+      } catch (const std::runtime_error&) {
+        throw orig_e;
+      }
+
+      throw orig_e;
+    }
+  }
+
+  /**
+   * @brief Get a read-only view of the lists of a list property for this element in flat (CSR) form, without copying
+   * them. Like getListPropertyType(), only succeeds if the property has type T exactly; throws otherwise. The view is
+   * valid until the property is resized, replaced, or removed.
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return A view of the lists.
+   */
+  template <class T>
+  ListSpan<const T> getListPropertySpan(const std::string& propertyName) {
+    TypedListProperty<T>& prop = getTypedListProperty<T>(propertyName);
+    return ListSpan<const T>(prop.flattenedData.data(), prop.flattenedIndexStart.data(),
+                             prop.flattenedIndexStart.size() - 1);
+  }
+
+  /**
+   * @brief Get a view of the lists of a list property for this element in flat (CSR) form, without copying them,
+   * through which the values can be changed in place. The lengths of the lists cannot be changed. Otherwise the same as
+   * getListPropertySpan().
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return A view of the lists.
+   */
+  template <class T>
+  ListSpan<T> getMutableListPropertySpan(const std::string& propertyName) {
+    TypedListProperty<T>& prop = getTypedListProperty<T>(propertyName);
+    return ListSpan<T>(prop.flattenedData.data(), prop.flattenedIndexStart.data(), prop.flattenedIndexStart.size() - 1);
+  }
+
+  /**
+   * @brief Get the lists of a list property for this element in flat (CSR) form. Automatically promotes to larger
+   * types, like getListProperty(), but costs two allocations rather than one per list.
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return The data.
+   */
+  template <class T>
+  FlatList<T> getListPropertyFlat(const std::string& propertyName) {
+
+    // Find the property
+    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
+
+    // Get a copy of the data with auto-promoting type magic
+    return getFlatDataFromListPropertyRecursive<T, T>(prop.get());
+  }
+
+  /**
+   * @brief Get the lists of a list property for this element in flat (CSR) form, converting between types of different
+   * sign like getListPropertyAnySign(). Otherwise the same as getListPropertyFlat().
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return The data.
+   */
+  template <class T>
+  FlatList<T> getListPropertyFlatAnySign(const std::string& propertyName) {
+
+    // Find the property
+    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
+
+    try {
+      return getFlatDataFromListPropertyRecursive<T, T>(prop.get());
+    } catch (const std::runtime_error& orig_e) {
+
+      // If the usual approach fails, look for a version with opposite signed-ness
+      try {
+        typedef typename CanonicalName<T>::type Tcan;
+        typedef typename std::conditional<std::is_signed<Tcan>::value, typename std::make_unsigned<Tcan>::type,
+                                          typename std::make_signed<Tcan>::type>::type OppsignType;
+
+        return getFlatDataFromListPropertyRecursive<T, OppsignType>(prop.get());
+
+      } catch (const std::runtime_error&) {
+        throw orig_e;
+      }
+    }
+  }
+
+
+  /**
+   * @brief Performs sanity checks on the element, throwing if any fail.
+   */
+  void validate() {
+
+    // Make sure no properties have duplicate names, and no names have whitespace
+    for (size_t iP = 0; iP < properties.size(); iP++) {
+      for (char c : properties[iP]->name) {
+        if (std::isspace(c)) {
+          throw std::runtime_error("Ply validate: illegal whitespace in name " + properties[iP]->name);
+        }
+      }
+      for (size_t jP = iP + 1; jP < properties.size(); jP++) {
+        if (properties[iP]->name == properties[jP]->name) {
+          throw std::runtime_error("Ply validate: multiple properties with name " + properties[iP]->name);
+        }
+      }
+    }
+
+    // Make sure all properties have right length
+    for (size_t iP = 0; iP < properties.size(); iP++) {
+      if (properties[iP]->size() != count) {
+        throw std::runtime_error("Ply validate: property has wrong size. " + properties[iP]->name +
+                                 " does not match element size.");
+      }
+    }
+  }
+
+  /**
+   * @brief Writes out this element's information to the file header.
+   *
+   * @param outStream The stream to use.
+   * @param countWidth If nonzero, the count is padded with trailing spaces to this many characters.
+   */
+  void writeHeader(std::ostream& outStream, size_t countWidth = 0) {
+
+    std::string countStr = std::to_string(count);
+    if (countStr.size() < countWidth) countStr.resize(countWidth, ' ');
+    outStream << "element " << name << " " << countStr << "\n";
+
+    for (std::unique_ptr<Property>& p : properties) {
+      p->writeHeader(outStream);
+    }
+  }
+
+  /**
+   * @brief (ASCII writing) Writes out all of the data for every element of this element type, including all contained
+   * properties.
+   *
+   * @param out The writer to format the text with.
+   */
+  void writeDataASCII(ASCIIWriter& out) { writeDataASCII(out, 0, count); }
+
+  /**
+   * @brief (ASCII writing) Writes out all of the data for every element of this element type to the stream, including
+   * all contained properties. Floating point values are written with the fewest digits which read back exactly.
+   *
+   * @param outStream The stream to write to.
+   */
+  void writeDataASCII(std::ostream& outStream) {
+    BufferedWriter buffer(outStream);
+    ASCIIWriter out(buffer);
+    writeDataASCII(out, 0, count);
+    buffer.flush();
+  }
+
+  /**
+   * @brief (ASCII writing) Writes out the data for a range of elements of this element type, one line each. Ranges may
+   * be written concurrently, each to its own writer.
+   *
+   * @param out The writer to format the text with.
+   * @param iStart The first element to write.
+   * @param iEnd One past the last element to write.
+   */
+  void writeDataASCII(ASCIIWriter& out, size_t iStart, size_t iEnd) {
+    // Question: what is the proper output for an element with no properties? Here, we write a blank line, so there is
+    // one line per element no matter what.
+    for (size_t iE = iStart; iE < iEnd; iE++) {
+      for (size_t iP = 0; iP < properties.size(); iP++) {
+        properties[iP]->writeDataASCII(out, iE);
+        if (iP < properties.size() - 1) {
+          out.put(' ');
+        }
+      }
+      out.put('\n');
+    }
+  }
+
+
+  /**
+   * @brief (binary writing) Writes out all of the data for every element of this element type to the stream, including
+   * all contained properties.
+   *
+   * @param outStream The stream to write to.
+   */
+  void writeDataBinary(std::ostream& outStream) {
+    BufferedWriter out(outStream);
+    writeDataBinary(out, false, 0, count);
+    out.flush();
+  }
+
+
+  /**
+   * @brief (binary writing) Writes out all of the data for every element of this element type to the stream, including
+   * all contained properties.
+   *
+   * @param outStream The stream to write to.
+   */
+  void writeDataBinaryBigEndian(std::ostream& outStream) {
+    BufferedWriter out(outStream);
+    writeDataBinary(out, true, 0, count);
+    out.flush();
+  }
+
+
+  /**
+   * @brief (binary writing) The number of bytes a range of elements of this element type takes in a binary file.
+   *
+   * @param iStart The first element.
+   * @param iEnd One past the last element.
+   *
+   * @return The number of bytes.
+   */
+  size_t binaryDataBytes(size_t iStart, size_t iEnd) {
+    size_t nBytes = 0;
+    for (std::unique_ptr<Property>& p : properties) {
+      const size_t* listStarts = p->listStartStorage();
+      if (listStarts == nullptr) {
+        nBytes += (iEnd - iStart) * p->valueByteWidth();
+      } else {
+        // A uchar count for each list, then its values
+        nBytes += (iEnd - iStart) + (listStarts[iEnd] - listStarts[iStart]) * p->valueByteWidth();
+      }
+    }
+    return nBytes;
+  }
+
+  /**
+   * @brief (binary writing) Writes out the data for a range of elements of this element type. Elements without list
+   * properties are packed a block of records at a time, one property after another; otherwise each record is packed in
+   * turn, copying each list in one go.
+   *
+   * @param out Where the bytes go.
+   * @param bigEndian Whether to write big endian values, rather than little endian.
+   * @param iStart The first element to write.
+   * @param iEnd One past the last element to write.
+   */
+  void writeDataBinary(BufferedWriter& out, bool bigEndian, size_t iStart, size_t iEnd) {
+
+    // Find where each property's values are, once
+    size_t nProps = properties.size();
+    std::vector<const char*> values(nProps);
+    std::vector<const size_t*> listStarts(nProps);
+    std::vector<size_t> widths(nProps);
+    size_t recordBytes = 0;
+    bool hasLists = false;
+    for (size_t iP = 0; iP < nProps; iP++) {
+      values[iP] = properties[iP]->valueStorage();
+      listStarts[iP] = properties[iP]->listStartStorage();
+      widths[iP] = properties[iP]->valueByteWidth();
+      if (listStarts[iP] == nullptr) {
+        recordBytes += widths[iP];
+      } else {
+        hasLists = true;
+      }
+    }
+
+    if (!hasLists) {
+      if (recordBytes == 0) return;
+      const size_t blockRecords = std::max<size_t>(1, (1 << 20) / recordBytes);
+      for (size_t iBlock = iStart; iBlock < iEnd; iBlock += blockRecords) {
+        size_t nRecords = std::min(blockRecords, iEnd - iBlock);
+        char* dst = out.reserve(nRecords * recordBytes);
+        for (size_t iP = 0; iP < nProps; iP++) {
+          scatterValues(dst, values[iP] + iBlock * widths[iP], nRecords, widths[iP], recordBytes, bigEndian);
+          dst += widths[iP];
+        }
+        out.commit(nRecords * recordBytes);
+      }
+      return;
+    }
+
+    for (size_t iE = iStart; iE < iEnd; iE++) {
+      for (size_t iP = 0; iP < nProps; iP++) {
+        size_t width = widths[iP];
+        if (listStarts[iP] == nullptr) {
+          scatterValues(out.reserve(width), values[iP] + iE * width, 1, width, width, bigEndian);
+          out.commit(width);
+          continue;
+        }
+
+        // Get the number of list elements as a uchar, and ensure the value fits
+        size_t dataStart = listStarts[iP][iE];
+        size_t dataCount = listStarts[iP][iE + 1] - dataStart;
+        if (dataCount > std::numeric_limits<uint8_t>::max()) {
+          throw std::runtime_error(
+              "List property has an element with more entries than fit in a uchar. See note in README.");
+        }
+        char* dst = out.reserve(1 + dataCount * width);
+        dst[0] = static_cast<char>(static_cast<uint8_t>(dataCount));
+        scatterValues(dst + 1, values[iP] + dataStart * width, dataCount, width, width, bigEndian);
+        out.commit(1 + dataCount * width);
+      }
+    }
+  }
+
+
+  /**
+   * @brief Find a property which has type T exactly. Throws if there is no such property.
+   *
+   * @tparam T The type of the property.
+   * @param propertyName The name of the property.
+   *
+   * @return The property.
+   */
+  template <class T>
+  TypedProperty<T>& getTypedProperty(const std::string& propertyName) {
+
+    // Find the property
+    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
+    TypedProperty<T>* castedProp = dynamic_cast<TypedProperty<T>*>(prop.get());
+    if (castedProp) {
+      return *castedProp;
+    }
+
+    // No match, failure
+    throw std::runtime_error("PLY parser: property " + prop->name + " is not of type type " + typeName<T>() +
+                             ". Has type " + prop->propertyTypeName());
+  }
+
+  /**
+   * @brief Find a list property which has type T exactly. Throws if there is no such property.
+   *
+   * @tparam T The type of the list entries.
+   * @param propertyName The name of the property.
+   *
+   * @return The property.
+   */
+  template <class T>
+  TypedListProperty<T>& getTypedListProperty(const std::string& propertyName) {
+
+    // Find the property
+    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
+    TypedListProperty<T>* castedProp = dynamic_cast<TypedListProperty<T>*>(prop.get());
+    if (castedProp) {
+      return *castedProp;
+    }
+
+    // No match, failure
+    throw std::runtime_error("PLY parser: list property " + prop->name + " is not of type " + typeName<T>() +
+                             ". Has type " + prop->propertyTypeName());
+  }
+
+  /**
+   * @brief Helper function which does the hard work to implement type promotion for data getters. Throws if type
+   * conversion fails.
+   *
+   * @tparam D The desired output type
+   * @tparam T The current attempt for the actual type of the property
+   * @param prop The property to get (does not delete nor share pointer)
+   *
+   * @return The data, with the requested type
+   */
+  template <class D, class T>
+  std::vector<D> getDataFromPropertyRecursive(Property* prop) {
+
+    typedef typename CanonicalName<T>::type Tcan;
+
+    { // Try to return data of type D from a property of type T
+      TypedProperty<Tcan>* castedProp = dynamic_cast<TypedProperty<Tcan>*>(prop);
+      if (castedProp) {
+        // Succeeded, return a buffer of the data (copy while converting type)
+        std::vector<D> castedVec;
+        castedVec.reserve(castedProp->data.size());
+        for (Tcan& v : castedProp->data) {
+          castedVec.push_back(static_cast<D>(v));
+        }
+        return castedVec;
+      }
+    }
+
+    TypeChain<Tcan> chainType;
+    if (chainType.hasChildType) {
+      return getDataFromPropertyRecursive<D, typename TypeChain<Tcan>::type>(prop);
+    } else {
+      // No smaller type to try, failure
+      throw std::runtime_error("PLY parser: property " + prop->name + " cannot be coerced to requested type " +
+                               typeName<D>() + ". Has type " + prop->propertyTypeName());
+    }
+  }
+
+
+  /**
+   * @brief Helper function which does the hard work to implement type promotion for list data getters. Throws if type
+   * conversion fails.
+   *
+   * @tparam D The desired output type
+   * @tparam T The current attempt for the actual type of the property
+   * @param prop The property to get (does not delete nor share pointer)
+   *
+   * @return The data, with the requested type
+   */
+  template <class D, class T>
+  std::vector<std::vector<D>> getDataFromListPropertyRecursive(Property* prop) {
+    typedef typename CanonicalName<T>::type Tcan;
+
+    TypedListProperty<Tcan>* castedProp = dynamic_cast<TypedListProperty<Tcan>*>(prop);
+    if (castedProp) {
+      // Succeeded, return a buffer of the data (copy while converting type)
+
+      // Convert to flat buffer of new type
+      std::vector<D>* castedFlatVec = nullptr;
+      std::vector<D> castedFlatVecCopy; // we _might_ make a copy here, depending on is_same below
+
+      if (std::is_same<std::vector<D>, std::vector<Tcan>>::value) {
+        // just use the array we already have
+        castedFlatVec = addressIfSame<std::vector<D>>(castedProp->flattenedData, 0 /* dummy arg to disambiguate */);
+      } else {
+        // make a copy
+        castedFlatVecCopy.reserve(castedProp->flattenedData.size());
+        for (Tcan& v : castedProp->flattenedData) {
+          castedFlatVecCopy.push_back(static_cast<D>(v));
+        }
+        castedFlatVec = &castedFlatVecCopy;
+      }
+
+      // Unflatten and return
+      return unflattenList(*castedFlatVec, castedProp->flattenedIndexStart);
+    }
+
+    TypeChain<Tcan> chainType;
+    if (chainType.hasChildType) {
+      return getDataFromListPropertyRecursive<D, typename TypeChain<Tcan>::type>(prop);
+    } else {
+      // No smaller type to try, failure
+      throw std::runtime_error("PLY parser: list property " + prop->name +
+                               " cannot be coerced to requested type list " + typeName<D>() + ". Has type list " +
+                               prop->propertyTypeName());
+    }
+  }
+
+  /**
+   * @brief Like getDataFromListPropertyRecursive(), but keeps the lists in flat form rather than splitting them out.
+   *
+   * @tparam D The desired output type
    * @tparam T The current attempt for the actual type of the property
    * @param prop The property to get (does not delete nor share pointer)
    *
-   * @return The data, with the requested type
+   * @return The data, with the requested type
+   */
+  template <class D, class T>
+  FlatList<D> getFlatDataFromListPropertyRecursive(Property* prop) {
+    typedef typename CanonicalName<T>::type Tcan;
+
+    TypedListProperty<Tcan>* castedProp = dynamic_cast<TypedListProperty<Tcan>*>(prop);
+    if (castedProp) {
+      // Succeeded, copy while converting type
+      FlatList<D> result;
+      result.flattenedData.assign(castedProp->flattenedData.begin(), castedProp->flattenedData.end());
+      result.flattenedIndexStart = castedProp->flattenedIndexStart;
+      return result;
+    }
+
+    TypeChain<Tcan> chainType;
+    if (chainType.hasChildType) {
+      return getFlatDataFromListPropertyRecursive<D, typename TypeChain<Tcan>::type>(prop);
+    } else {
+      // No smaller type to try, failure
+      throw std::runtime_error("PLY parser: list property " + prop->name +
+                               " cannot be coerced to requested type list " + typeName<D>() + ". Has type list " +
+                               prop->propertyTypeName());
+    }
+  }
+};
+
+
+// Some string helpers
+namespace {
+
+inline std::string trimSpaces(const std::string& input) {
+  size_t start = 0;
+  while (start < input.size() && input[start] == ' ') start++;
+  size_t end = input.size();
+  while (end > start && (input[end - 1] == ' ' || input[end - 1] == '\n' || input[end - 1] == '\r')) end--;
+  return input.substr(start, end - start);
+}
+
+inline std::vector<std::string> tokenSplit(const std::string& input) {
+  std::vector<std::string> result;
+  size_t curr = 0;
+  size_t found = 0;
+  while ((found = input.find_first_of(' ', curr)) != std::string::npos) {
+    std::string token = input.substr(curr, found - curr);
+    token = trimSpaces(token);
+    if (token.size() > 0) {
+      result.push_back(token);
+    }
+    curr = found + 1;
+  }
+  std::string token = input.substr(curr);
+  token = trimSpaces(token);
+  if (token.size() > 0) {
+    result.push_back(token);
+  }
+
+  return result;
+}
+
+inline bool startsWith(const std::string& input, const std::string& query) {
+  return input.compare(0, query.length(), query) == 0;
+}
+}; // namespace
+
+
+/**
+ * @brief (binary reading) A compiled program for decoding the binary records of an element. It is built once from the
+ * layout of the element's properties, after which records are decoded by a single loop over the program rather than by
+ * calls in to each Property. A plan only depends on the widths of the properties, which of them are loaded, and the
+ * byte order, so it can be shared by every element with the same layout (see DecodePlanCache).
+ */
+class DecodePlan {
+
+public:
+  /**
+   * @brief How one property is laid out in each record.
+   */
+  struct Step {
+    size_t valueBytes; // width of the value, or of each value in the list
+    size_t countBytes; // width of the list count, or 0 if the property is not a list
+    size_t offset;     // offset of the property within each record, if the element has a fixed stride
+    bool load;         // decode the property, or just skip over it?
+  };
+
+  /**
+   * @brief Where one property is decoded to. These are bound separately from the plan, since they belong to a
+   * particular element and move as its storage grows.
+   */
+  struct Target {
+    char* values = nullptr;       // see Property::valueStorage()
+    size_t* listStarts = nullptr; // see Property::listStartStorage()
+    size_t valueStride = 0;       // bytes between the values of consecutive records, or 0 if they are packed
+  };
+
+  /**
+   * @brief Compile the plan for an element.
+   *
+   * @param elem The element, whose properties give the layout.
+   * @param load For each property, should it be decoded or skipped over?
+   * @param bigEndian_ Is the data stored big endian?
+   */
+  DecodePlan(Element& elem, const std::vector<bool>& load, bool bigEndian_) : bigEndian(bigEndian_) {
+    bool hasLists = false;
+    for (size_t iP = 0; iP < elem.properties.size(); iP++) {
+      Property& prop = *elem.properties[iP];
+      Step step{prop.valueByteWidth(), prop.listCountByteWidth(), minRecordBytes, load[iP]};
+      steps.push_back(step);
+      hasLists = hasLists || step.countBytes > 0;
+      minRecordBytes += step.countBytes > 0 ? step.countBytes : step.valueBytes;
+    }
+    stride = hasLists ? 0 : minRecordBytes;
+  }
+
+  /**
+   * @brief A key which is the same for exactly those elements which would compile to the same plan.
+   *
+   * @param elem The element.
+   * @param load For each property, should it be decoded or skipped over?
+   * @param bigEndian Is the data stored big endian?
+   *
+   * @return The key.
+   */
+  static std::string layoutKey(Element& elem, const std::vector<bool>& load, bool bigEndian) {
+    std::string key(1, bigEndian ? 'B' : 'L');
+    for (size_t iP = 0; iP < elem.properties.size(); iP++) {
+      key.push_back(static_cast<char>(elem.properties[iP]->valueByteWidth()));
+      key.push_back(static_cast<char>(elem.properties[iP]->listCountByteWidth()));
+      key.push_back(load[iP] ? '+' : '-');
+    }
+    return key;
+  }
+
+  std::vector<Step> steps;
+  size_t stride = 0;         // bytes in each record, or 0 if the element has list properties
+  size_t minRecordBytes = 0; // bytes in a record if every list is empty
+  bool bigEndian;
+
+  /**
+   * @brief The number of bytes in a record.
+   *
+   * @param record Start of the record.
+   * @param end End of the available bytes.
+   *
+   * @return The width in bytes, or 0 if the record is not complete.
+   */
+  size_t recordBytes(const char* record, const char* end) const {
+    size_t available = end - record;
+    size_t width = stride;
+    if (stride == 0) {
+      for (const Step& step : steps) {
+        if (step.countBytes == 0) {
+          width += step.valueBytes;
+        } else {
+          if (available < width + step.countBytes) return 0;
+          width += step.countBytes + listCount(record + width, step.countBytes) * step.valueBytes;
+        }
+      }
+    }
+    return width <= available ? width : 0;
+  }
+
+  /**
+   * @brief A lower bound on the number of bytes in a record which may not be complete, using the counts of any of its
+   * lists which are available.
+   *
+   * @param record Start of the record.
+   * @param end End of the available bytes.
+   *
+   * @return The lower bound in bytes.
+   */
+  size_t recordBytesLowerBound(const char* record, const char* end) const {
+    size_t available = end - record;
+    size_t width = 0;
+    for (const Step& step : steps) {
+      width += step.countBytes > 0 ? step.countBytes : step.valueBytes;
+      if (step.countBytes > 0 && available >= width) {
+        width += listCount(record + width - step.countBytes, step.countBytes) * step.valueBytes;
+      }
+    }
+    return width;
+  }
+
+  /**
+   * @brief Count the values in consecutive complete records, for each property which is loaded.
+   *
+   * @param record Start of the first record.
+   * @param nRecords Number of records.
+   * @param nValues For each property, incremented by the number of values (1 per record if it is not a list).
+   */
+  void countValues(const char* record, size_t nRecords, size_t* nValues) const {
+    for (size_t iRec = 0; iRec < nRecords; iRec++) {
+      for (size_t iS = 0; iS < steps.size(); iS++) {
+        const Step& step = steps[iS];
+        if (step.countBytes == 0) {
+          if (step.load) nValues[iS]++;
+          record += step.valueBytes;
+        } else {
+          size_t count = listCount(record, step.countBytes);
+          if (step.load) nValues[iS] += count;
+          record += step.countBytes + count * step.valueBytes;
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Decode consecutive complete records in to place.
+   *
+   * @param record Start of the first record.
+   * @param nRecords Number of records.
+   * @param targets Where each property is decoded to.
+   * @param iEntry Index of the entry to write the first record to.
+   * @param iValue For each list property, the index of the first value to write. Advanced past the values written.
+   */
+  void decodeRecords(const char* record, size_t nRecords, const Target* targets, size_t iEntry, size_t* iValue) const {
+    std::vector<size_t> firstValue(iValue, iValue + steps.size());
+    for (size_t iRec = iEntry; iRec < iEntry + nRecords; iRec++) {
+      for (size_t iS = 0; iS < steps.size(); iS++) {
+        const Step& step = steps[iS];
+        if (step.countBytes == 0) {
+          if (step.load) copyValue(targets[iS].values + iRec * valueStride(targets[iS], step), record, step.valueBytes);
+          record += step.valueBytes;
+        } else {
+          size_t count = listCount(record, step.countBytes);
+          record += step.countBytes;
+          size_t nBytes = count * step.valueBytes;
+          if (step.load) {
+            if (nBytes > 0) std::memcpy(targets[iS].values + iValue[iS] * step.valueBytes, record, nBytes);
+            iValue[iS] += count;
+            targets[iS].listStarts[iRec + 1] = iValue[iS];
+          }
+          record += nBytes;
+        }
+      }
+    }
+
+    // Swap everything which was just written in one go
+    if (bigEndian) {
+      for (size_t iS = 0; iS < steps.size(); iS++) {
+        const Step& step = steps[iS];
+        if (!step.load) continue;
+        if (step.countBytes == 0) {
+          size_t dstStride = valueStride(targets[iS], step);
+          swapEndianStrided(targets[iS].values + iEntry * dstStride, nRecords, step.valueBytes, dstStride);
+        } else {
+          swapEndianBytes(targets[iS].values + firstValue[iS] * step.valueBytes, iValue[iS] - firstValue[iS],
+                          step.valueBytes);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Decode consecutive records of an element with a fixed stride in to place, a property at a time.
+   *
+   * @param block Start of the first record.
+   * @param nRecords Number of records.
+   * @param targets Where each property is decoded to.
+   * @param iEntry Index of the entry to write the first record to.
+   */
+  void decodeFixedStride(const char* block, size_t nRecords, const Target* targets, size_t iEntry) const {
+    if (nRecords == 0) return;
+    for (size_t iS = 0; iS < steps.size(); iS++) {
+      const Step& step = steps[iS];
+      if (!step.load) continue;
+      size_t dstStride = valueStride(targets[iS], step);
+      char* dst = targets[iS].values + iEntry * dstStride;
+      const char* src = block + step.offset;
+      if (stride == step.valueBytes && dstStride == step.valueBytes) {
+        std::memcpy(dst, src, nRecords * step.valueBytes);
+      } else {
+        switch (step.valueBytes) {
+        case 1:
+          gather<1>(dst, src, nRecords, stride, dstStride);
+          break;
+        case 2:
+          gather<2>(dst, src, nRecords, stride, dstStride);
+          break;
+        case 4:
+          gather<4>(dst, src, nRecords, stride, dstStride);
+          break;
+        case 8:
+          gather<8>(dst, src, nRecords, stride, dstStride);
+          break;
+        default:
+          for (size_t iRec = 0; iRec < nRecords; iRec++) {
+            std::memcpy(dst + iRec * dstStride, src + iRec * stride, step.valueBytes);
+          }
+        }
+      }
+      if (bigEndian) swapEndianStrided(dst, nRecords, step.valueBytes, dstStride);
+    }
+  }
+
+private:
+  // Bytes between the values of consecutive records in a target
+  static size_t valueStride(const Target& target, const Step& step) {
+    return target.valueStride > 0 ? target.valueStride : step.valueBytes;
+  }
+
+  // Decode a list count (always as if unsigned, see createPropertyWithType())
+  size_t listCount(const char* entry, size_t countBytes) const {
+    switch (countBytes) {
+    case 1:
+      return static_cast<uint8_t>(*entry);
+    case 2: {
+      uint16_t c;
+      std::memcpy(&c, entry, 2);
+      return bigEndian ? byteSwap(c) : c;
+    }
+    case 4: {
+      uint32_t c;
+      std::memcpy(&c, entry, 4);
+      return bigEndian ? byteSwap(c) : c;
+    }
+    case 8: {
+      uint64_t c;
+      std::memcpy(&c, entry, 8);
+      return static_cast<size_t>(bigEndian ? byteSwap(c) : c);
+    }
+    default:
+      return 0;
+    }
+  }
+
+  // Copy a single value, with a fixed-size copy for the common widths
+  static void copyValue(char* dst, const char* src, size_t width) {
+    switch (width) {
+    case 1:
+      *dst = *src;
+      break;
+    case 2:
+      std::memcpy(dst, src, 2);
+      break;
+    case 4:
+      std::memcpy(dst, src, 4);
+      break;
+    case 8:
+      std::memcpy(dst, src, 8);
+      break;
+    default:
+      std::memcpy(dst, src, width);
+    }
+  }
+
+  // Copy one N byte value from each record (memcpy rather than casting, since records need not be aligned)
+  template <size_t N>
+  static void gather(char* dst, const char* src, size_t nRecords, size_t stride, size_t dstStride) {
+    if (dstStride == N) {
+      for (size_t iRec = 0; iRec < nRecords; iRec++) {
+        std::memcpy(dst + iRec * N, src + iRec * stride, N);
+      }
+    } else {
+      for (size_t iRec = 0; iRec < nRecords; iRec++) {
+        std::memcpy(dst + iRec * dstStride, src + iRec * stride, N);
+      }
+    }
+  }
+};
+
+
+/**
+ * @brief A cache of compiled decode plans, which can be shared between reads (see ReadOptions::planCache) so that a
+ * batch of files with the same header does not compile the same plans over and over. Safe to use from several threads
+ * at once.
+ */
+class DecodePlanCache {
+
+public:
+  /**
+   * @brief Get the plan for an element, compiling it if there is not one already.
+   *
+   * @param elem The element.
+   * @param load For each property, should it be decoded or skipped over?
+   * @param bigEndian Is the data stored big endian?
+   *
+   * @return The plan.
+   */
+  std::shared_ptr<const DecodePlan> get(Element& elem, const std::vector<bool>& load, bool bigEndian) {
+    std::string key = DecodePlan::layoutKey(elem, load, bigEndian);
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const DecodePlan>& plan = plans[key];
+    if (!plan) {
+      plan = std::make_shared<DecodePlan>(elem, load, bigEndian);
+    }
+    return plan;
+  }
+
+  /**
+   * @brief The number of distinct plans in the cache.
+   */
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return plans.size();
+  }
+
+private:
+  std::mutex mutex;
+  std::map<std::string, std::shared_ptr<const DecodePlan>> plans;
+};
+
+
+/**
+ * @brief Memory which a scalar property is decoded in to, rather than in to the PLYData (see ReadOptions::bind()).
+ */
+struct PropertyBinding {
+  std::string element;
+  std::string property;
+  std::string typeName; // type of the values in memory, see typeName()
+  char* values;         // where the value of the first record goes
+  size_t capacity;      // number of records there is room for
+  size_t strideBytes;   // bytes between the values of consecutive records
+  std::function<void(Element&)> copyFrom; // convert the loaded property and copy it in, when the types differ
+};
+
+
+/**
+ * @brief Options which control how a PLYData is read.
+ */
+struct ReadOptions {
+
+  /**
+   * @brief If true, print useful info about the file to stdout.
+   */
+  bool verbose = false;
+
+  /**
+   * @brief If true, only the header is parsed up front, and each element's data is decoded the first time the element
+   * is accessed via PLYData::getElement() (or something which calls it). Elements which are never accessed are never
+   * decoded. Only supported when reading from a file, which is held open until every element has been loaded.
+   */
+  bool lazy = false;
+
+  /**
+   * @brief If nonempty, only these elements and properties are loaded. Everything else in the file is skipped over
+   * without being decoded, and does not appear in the PLYData. Maps the name of each element to load to the names of
+   * its properties to load; an empty list loads all of the element's properties. Names which do not appear in the file
+   * are ignored.
+   */
+  std::map<std::string, std::vector<std::string>> projection;
+
+  /**
+   * @brief Number of threads to use when decoding large elements, binary or ASCII. 0 means one per hardware thread.
+   */
+  size_t threads = 1;
+
+  /**
+   * @brief Number of bytes to read from the file at a time. Binary elements are decoded in blocks of this many bytes per
+   * thread.
+   */
+  size_t bufferBytes = 1 << 22;
+
+  /**
+   * @brief If true, a background thread reads ahead of the decoding in to a ring of buffers, so that waiting on the
+   * disk and decoding overlap.
+   */
+  bool prefetch = false;
+
+  /**
+   * @brief (files, not on Windows) If true, a file is read with several large reads in flight at once, using io_uring
+   * on Linux. Falls back to plain reads where io_uring is not available. Not used for lazy loading.
+   */
+  bool asyncIO = false;
+
+  /**
+   * @brief (files, not on Windows) How reading treats the page cache; see PageCacheMode. Anything but the default reads
+   * through a file descriptor with plain reads, or io_uring if asyncIO is set. Not used for lazy loading.
+   */
+  PageCacheMode pageCache = PageCacheMode::Default;
+
+  /**
+   * @brief If set, compiled decode plans for binary elements are taken from (and added to) this cache. Share one cache
+   * between reads of many files with the same header to compile each plan only once.
+   */
+  std::shared_ptr<DecodePlanCache> planCache;
+
+  /**
+   * @brief Memory which scalar properties are decoded in to, rather than in to the PLYData. See bind().
+   */
+  std::vector<PropertyBinding> bindings;
+
+  /**
+   * @brief Decode a scalar property in to memory owned by the caller, such as an interleaved vertex buffer, rather than
+   * in to the PLYData. The property does not appear in the PLYData after it is loaded. If T matches the type in the
+   * file, binary data is decoded straight in to place; otherwise the values are loaded and then converted as by
+   * Element::getProperty(). Properties which do not appear in the file are ignored. PLYReader throws if any are given.
+   *
+   * @tparam T The type of the values in memory.
+   * @param element Name of the element.
+   * @param property Name of the property.
+   * @param dst Where to put the value of the first record.
+   * @param capacity Number of records there is room for. Reading throws if the element has more.
+   * @param strideBytes Number of bytes from the value of one record to the value of the next.
+   */
+  template <class T>
+  void bind(const std::string& element, const std::string& property, T* dst, size_t capacity,
+            size_t strideBytes = sizeof(T)) {
+    std::function<void(Element&)> copyFrom = [property, dst, strideBytes](Element& elem) {
+      std::vector<T> values = elem.getProperty<T>(property);
+      char* bytes = reinterpret_cast<char*>(dst);
+      for (size_t i = 0; i < values.size(); i++) {
+        std::memcpy(bytes + i * strideBytes, &values[i], sizeof(T));
+      }
+    };
+    bindings.push_back(PropertyBinding{element, property, typeName<T>(), reinterpret_cast<char*>(dst), capacity,
+                                       strideBytes, copyFrom});
+  }
+};
+
+
+/**
+ * @brief Options which control how a PLYData is written.
+ */
+struct WriteOptions {
+
+  /**
+   * @brief (ASCII) Number of significant digits to write floating point values with. 0 writes the shortest text which
+   * reads back as exactly the same value. Anything else may lose precision, in exchange for smaller files.
+   */
+  int precision = 0;
+
+  /**
+   * @brief Number of bytes to collect before writing them to the file.
+   */
+  size_t bufferBytes = 1 << 22;
+
+  /**
+   * @brief Number of threads to use when formatting large elements in ASCII, or when writing binary files (not
+   * streams), which are then mapped in to memory and filled in directly. 0 means one per hardware thread. The file is
+   * the same no matter how many threads are used.
+   */
+  size_t threads = 1;
+
+  /**
+   * @brief (files, not on Windows) With PageCacheMode::DropBehind, the file is written back to disk and dropped from
+   * the page cache as it is written, rather than filling the cache. Other modes make no difference to writing.
+   */
+  PageCacheMode pageCache = PageCacheMode::Default;
+};
+
+
+/**
+ * @brief (reading) Reads ahead of a BufferedReader, handing out the bytes in order on request.
+ */
+class ReadAhead {
+
+public:
+  virtual ~ReadAhead() {}
+
+  /**
+   * @brief Copy out the next bytes, waiting for them to be read if necessary.
+   *
+   * @param dst Where to copy the bytes.
+   * @param nBytes Number of bytes to copy.
+   *
+   * @return The number of bytes copied, which is less than nBytes only if the input ended.
+   */
+  virtual size_t read(char* dst, size_t nBytes) = 0;
+
+  /**
+   * @brief Stop reading, and leave the stream positioned just after the bytes which were read from it.
+   *
+   * @return The number of bytes which were read from the stream but not handed out.
+   */
+  virtual size_t stop() = 0;
+};
+
+
+/**
+ * @brief (reading) Reads a stream on a background thread, in to a ring of blocks which are handed out on request. The
+ * stream must not be used by anything else until stop() is called.
+ */
+class StreamPrefetcher : public ReadAhead {
+
+public:
+  /**
+   * @brief Start reading from the current position of a stream.
+   *
+   * @param stream_ The stream to read from.
+   * @param blockBytes_ Number of bytes in each block.
+   * @param nBlocks_ Largest number of blocks to read ahead.
+   */
+  StreamPrefetcher(std::istream& stream_, size_t blockBytes_, size_t nBlocks_ = 3)
+      : stream(stream_), blockBytes(std::max<size_t>(blockBytes_, 1)), nBlocks(std::max<size_t>(nBlocks_, 1)) {
+    worker = std::thread([this]() { readAhead(); });
+  }
+
+  virtual ~StreamPrefetcher() override { stop(); }
+
+  /**
+   * @brief Copy out the next bytes of the stream, waiting for them to be read if necessary.
+   *
+   * @param dst Where to copy the bytes.
+   * @param nBytes Number of bytes to copy.
+   *
+   * @return The number of bytes copied, which is less than nBytes only if the stream ended.
+   */
+  virtual size_t read(char* dst, size_t nBytes) override {
+    size_t nCopied = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (nCopied < nBytes) {
+      changed.wait(lock, [&]() { return !ready.empty() || ended || error; });
+      if (error) std::rethrow_exception(error);
+      if (ready.empty()) break; // the stream ended
+
+      Block& block = ready.front();
+      size_t n = std::min(nBytes - nCopied, block.size - block.used);
+      std::memcpy(dst + nCopied, &block.data[block.used], n);
+      block.used += n;
+      nCopied += n;
+      if (block.used == block.size) {
+        spare.push_back(std::move(block.data));
+        ready.pop_front();
+        changed.notify_all();
+      }
+    }
+    return nCopied;
+  }
+
+  /**
+   * @brief Stop reading and wait for the background thread to finish.
+   *
+   * @return The number of bytes which were read from the stream but not handed out.
+   */
+  virtual size_t stop() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    changed.notify_all();
+    if (worker.joinable()) worker.join();
+
+    size_t nUnused = 0;
+    for (Block& block : ready) {
+      nUnused += block.size - block.used;
+    }
+    ready.clear();
+    return nUnused;
+  }
+
+private:
+  struct Block {
+    std::vector<char> data;
+    size_t size;
+    size_t used;
+  };
+
+  // The background thread: read blocks until the stream ends, staying at most nBlocks ahead
+  void readAhead() {
+    try {
+      while (true) {
+        std::vector<char> data;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          changed.wait(lock, [&]() { return stopping || ready.size() < nBlocks; });
+          if (stopping) return;
+          if (!spare.empty()) {
+            data = std::move(spare.back());
+            spare.pop_back();
+          }
+        }
+
+        data.resize(blockBytes);
+        stream.read(&data[0], blockBytes);
+        size_t nRead = static_cast<size_t>(stream.gcount());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (nRead > 0) ready.push_back(Block{std::move(data), nRead, 0});
+        if (nRead < blockBytes) {
+          ended = true;
+          changed.notify_all();
+          return;
+        }
+        changed.notify_all();
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      error = std::current_exception();
+      changed.notify_all();
+    }
+  }
+
+  std::istream& stream;
+  size_t blockBytes;
+  size_t nBlocks;
+  std::thread worker;
+
+  // Shared with the background thread, guarded by the mutex
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<Block> ready;              // blocks which have been read, in order
+  std::vector<std::vector<char>> spare; // blocks which have been used up, to be refilled
+  bool ended = false;
+  bool stopping = false;
+  std::exception_ptr error;
+};
+
+
+#if !defined(_WIN32)
+/**
+ * @brief Pushes the parts of a file which have been used out of the page cache (see PageCacheMode::DropBehind). Pages
+ * which have been written are written back to disk first: each call starts writing back what is new, and waits for
+ * and drops what the call before started, so that the disk is kept busy.
+ */
+class PageCacheDropper {
+
+public:
+  /**
+   * @brief Drop the pages of a file as they are read, through a descriptor which stays owned by the caller.
+   *
+   * @param fd_ The file.
+   */
+  explicit PageCacheDropper(int fd_) : fd(fd_) {}
+
+  /**
+   * @brief Drop the pages of a file as it is written, through some other means such as a stream.
+   *
+   * @param filename The file being written, which must already exist.
+   */
+  explicit PageCacheDropper(const std::string& filename)
+      : fd(open(filename.c_str(), O_RDONLY | O_CLOEXEC)), ownsFd(true), written(true) {
+    if (fd < 0) {
+      throw std::runtime_error("Ply writer: Could not open output file " + filename);
+    }
+  }
+
+  ~PageCacheDropper() {
+    if (ownsFd) close(fd);
+  }
+
+  PageCacheDropper(const PageCacheDropper&) = delete;
+  PageCacheDropper& operator=(const PageCacheDropper&) = delete;
+
+  /**
+   * @brief Note that the file has been used up to some offset. Nothing is done until enough is new to be worth it.
+   *
+   * @param end Offset of the end of the used part of the file.
+   */
+  void advance(uint64_t end) {
+    if (end < issued + minBytes) return;
+    if (!written) {
+      drop(fd, dropped, end);
+      dropped = issued = end;
+      return;
+    }
+#if defined(__linux__)
+    sync_file_range(fd, static_cast<off64_t>(issued), static_cast<off64_t>(end - issued), SYNC_FILE_RANGE_WRITE);
+    if (issued > dropped) {
+      sync_file_range(fd, static_cast<off64_t>(dropped), static_cast<off64_t>(issued - dropped),
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+      drop(fd, dropped, issued);
+      dropped = issued;
+    }
+    issued = end;
+#endif
+  }
+
+  /**
+   * @brief Note that the file has been used up to some offset, and drop everything used so far, waiting for it to be
+   * written back if necessary.
+   *
+   * @param end Offset of the end of the used part of the file.
+   */
+  void finish(uint64_t end) {
+    if (end <= dropped) return;
+    if (written) {
+#if defined(__linux__)
+      sync_file_range(fd, static_cast<off64_t>(dropped), static_cast<off64_t>(end - dropped),
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#else
+      fsync(fd);
+#endif
+    }
+    drop(fd, dropped, end);
+    dropped = issued = end;
+  }
+
+  /**
+   * @brief Drop a range of a file from the page cache, if it is not dirty or mapped.
+   *
+   * @param fd The file.
+   * @param begin Offset of the start of the range.
+   * @param end Offset of the end of the range.
+   */
+  static void drop(int fd, uint64_t begin, uint64_t end) {
+#if defined(POSIX_FADV_DONTNEED)
+    if (end > begin) {
+      posix_fadvise(fd, static_cast<off_t>(begin), static_cast<off_t>(end - begin), POSIX_FADV_DONTNEED);
+    }
+#endif
+  }
+
+private:
+  static const uint64_t minBytes = 1 << 24; // least amount worth dropping at a time
+
+  int fd;
+  bool ownsFd = false;
+  bool written = false; // whether the pages are being written, so must be written back before they are dropped
+  uint64_t dropped = 0; // everything before this has been dropped
+  uint64_t issued = 0;  // everything before this has been started writing back
+};
+
+
+/**
+ * @brief (reading) Reads the rest of a file which is open as a stream, through its own file descriptor. With io_uring
+ * (on Linux), a ring of blocks is kept in flight, and each block is submitted again as soon as it has been handed out;
+ * otherwise, each request is a plain read. The stream must not be used by anything else until stop() is called.
+ */
+class FileReadAhead : public ReadAhead {
+
+public:
+  /**
+   * @brief Start reading from the current position of a stream, which must have been opened on the file.
+   *
+   * @param filename The file to read.
+   * @param stream_ The stream the file is open as.
+   * @param blockBytes_ Number of bytes in each read.
+   * @param nBlocks Number of reads to keep in flight.
+   * @param useRing If false, always use plain reads.
+   * @param cacheMode How to treat the page cache.
+   */
+  FileReadAhead(const std::string& filename, std::istream& stream_, size_t blockBytes_, size_t nBlocks = 4,
+                bool useRing = true, PageCacheMode cacheMode = PageCacheMode::Default)
+      : stream(stream_), blockBytes(std::max<size_t>(blockBytes_, 1)) {
+    fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0) {
+      if (fd >= 0) close(fd);
+      throw std::runtime_error("PLY parser: Could not open file " + filename);
+    }
+    fileSize = static_cast<uint64_t>(fileStat.st_size);
+    position = static_cast<uint64_t>(stream.tellg());
+    nextOffset = position;
+
+    // The destructor does not run if this throws, so clean up here, after any reads already submitted have finished
+    try {
+      if (cacheMode != PageCacheMode::Default) {
+#if defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+      }
+      if (cacheMode == PageCacheMode::DropBehind) dropper.reset(new PageCacheDropper(fd));
+
+#ifdef HAPPLY_IO_URING
+      if (useRing && setupRing(nBlocks)) {
+        slots.resize(std::max<size_t>(nBlocks, 1));
+        for (size_t iSlot = 0; iSlot < slots.size(); iSlot++) {
+          submitBlock(iSlot);
+        }
+      }
+#endif
+    } catch (...) {
+      release();
+      throw;
+    }
+  }
+
+  virtual ~FileReadAhead() override { release(); }
+
+  FileReadAhead(const FileReadAhead&) = delete;
+  FileReadAhead& operator=(const FileReadAhead&) = delete;
+
+  /**
+   * @brief Whether reads are actually going through io_uring.
+   */
+  bool usingRing() const {
+#ifdef HAPPLY_IO_URING
+    return ringFd >= 0;
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * @brief Copy out the next bytes of the file, waiting for them to be read if necessary.
+   *
+   * @param dst Where to copy the bytes.
+   * @param nBytes Number of bytes to copy.
+   *
+   * @return The number of bytes copied, which is less than nBytes only if the file ended.
+   */
+  virtual size_t read(char* dst, size_t nBytes) override {
+    size_t nCopied = 0;
+    if (!usingRing()) {
+      while (nCopied < nBytes) {
+        ssize_t n = pread(fd, dst + nCopied, nBytes - nCopied, static_cast<off_t>(position));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw std::runtime_error("PLY parser: error reading file: " + std::string(std::strerror(errno)));
+        if (n == 0) break;
+        nCopied += static_cast<size_t>(n);
+        position += static_cast<uint64_t>(n);
+      }
+      if (dropper) dropper->advance(position);
+      return nCopied;
+    }
+
+#ifdef HAPPLY_IO_URING
+    while (nCopied < nBytes && !inFlight.empty()) {
+      Slot& slot = slots[inFlight.front()];
+      while (!slot.done) waitForCompletions();
+
+      size_t n = std::min(nBytes - nCopied, slot.filled - slot.used);
+      if (n > 0) std::memcpy(dst + nCopied, &slot.data[slot.used], n);
+      slot.used += n;
+      nCopied += n;
+      position += n;
+      if (slot.used == slot.filled) {
+        size_t iSlot = inFlight.front();
+        inFlight.pop_front();
+        if (slot.filled < slot.size) {
+          nextOffset = fileSize; // the file was shorter than it was when opened
+        }
+        submitBlock(iSlot);
+      }
+    }
+    if (dropper) dropper->advance(position);
+#endif
+    return nCopied;
+  }
+
+  /**
+   * @brief Stop reading, waiting for any reads in flight to finish, and put the stream just after the bytes which were
+   * handed out.
+   *
+   * @return Always 0, since the stream is already in place.
+   */
+  virtual size_t stop() override {
+    if (stopped) return 0;
+    stopped = true;
+#ifdef HAPPLY_IO_URING
+    // Wait for every read the kernel has been given, including any after a failed one, but do not start more
+    inFlight.clear();
+    while (ringFd >= 0 && pending > 0) {
+      waitForCompletions(true);
+    }
+#endif
+    if (dropper) dropper->finish(position);
+    stream.clear();
+    stream.seekg(static_cast<std::streamoff>(position));
+    return 0;
+  }
+
+private:
+  // Wait for any reads in flight, then close the ring and the file
+  void release() {
+    try {
+      stop();
+    } catch (...) {
+    }
+#ifdef HAPPLY_IO_URING
+    if (ringFd >= 0) {
+      if (pending > 0) {
+        // The ring could not be drained, so the kernel may still write in to the buffers; never free them
+        new std::vector<Slot>(std::move(slots));
+      }
+      closeRing();
+    }
+#endif
+    close(fd);
+  }
+
+#ifdef HAPPLY_IO_URING
+  struct Slot {
+    std::vector<char> data;
+    uint64_t offset = 0; // where in the file the block starts
+    size_t size = 0;     // number of bytes requested
+    size_t filled = 0;   // number of bytes read so far
+    size_t used = 0;     // number of bytes handed out so far
+    bool done = true;
+  };
+
+  // Create the ring and map its queues, returning false if io_uring (with IORING_OP_READ) is not available
+  bool setupRing(size_t nBlocks) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int ring = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(nBlocks), &params));
+    if (ring < 0) return false;
+
+    sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap) sqRingBytes = cqRingBytes = std::max(sqRingBytes, cqRingBytes);
+    sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+
+    auto mapRing = [&](size_t nBytes, off_t offset) -> char* {
+      void* ptr = mmap(nullptr, nBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, offset);
+      return ptr == MAP_FAILED ? nullptr : static_cast<char*>(ptr);
+    };
+    sqRing = mapRing(sqRingBytes, IORING_OFF_SQ_RING);
+    cqRing = singleMap ? sqRing : mapRing(cqRingBytes, IORING_OFF_CQ_RING);
+    sqes = reinterpret_cast<io_uring_sqe*>(mapRing(sqesBytes, IORING_OFF_SQES));
+    ringFd = ring;
+    if (sqRing == nullptr || cqRing == nullptr || sqes == nullptr) {
+      closeRing();
+      return false;
+    }
+
+    // Kernels before 5.6 create the ring, but fail every IORING_OP_READ, so ask which operations are supported
+    const size_t nProbeOps = 256;
+    std::vector<char> probeBytes(sizeof(io_uring_probe) + nProbeOps * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probeBytes.data());
+    bool canRead = syscall(__NR_io_uring_register, ring, IORING_REGISTER_PROBE, probe, nProbeOps) >= 0 &&
+                   IORING_OP_READ < probe->ops_len && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) != 0;
+    if (!canRead) {
+      closeRing();
+      return false;
+    }
+
+    sqTail = reinterpret_cast<unsigned*>(sqRing + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(sqRing + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sqRing + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned*>(cqRing + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cqRing + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(cqRing + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+    return true;
+  }
+
+  // Unmap the queues and close the ring
+  void closeRing() {
+    if (sqes != nullptr) munmap(sqes, sqesBytes);
+    if (cqRing != nullptr && cqRing != sqRing) munmap(cqRing, cqRingBytes);
+    if (sqRing != nullptr) munmap(sqRing, sqRingBytes);
+    sqRing = cqRing = nullptr;
+    sqes = nullptr;
+    close(ringFd);
+    ringFd = -1;
+  }
+
+  // Start reading the next block of the file in to a slot, if there is any of the file left
+  void submitBlock(size_t iSlot) {
+    if (nextOffset >= fileSize) return;
+    Slot& slot = slots[iSlot];
+    slot.offset = nextOffset;
+    slot.size = static_cast<size_t>(std::min<uint64_t>(blockBytes, fileSize - nextOffset));
+    slot.filled = 0;
+    slot.used = 0;
+    slot.done = false;
+    if (slot.data.size() < slot.size) slot.data.resize(slot.size);
+    nextOffset += slot.size;
+    inFlight.push_back(iSlot);
+    submitRead(iSlot);
+  }
+
+  // Queue a read of the rest of a slot's block, and tell the kernel about it
+  void submitRead(size_t iSlot) {
+    Slot& slot = slots[iSlot];
+    unsigned tail = *sqTail;
+    unsigned index = tail & sqMask;
+    io_uring_sqe& sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<uint64_t>(&slot.data[slot.filled]);
+    sqe.len = static_cast<unsigned>(slot.size - slot.filled);
+    sqe.off = slot.offset + slot.filled;
+    sqe.user_data = iSlot;
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    pending++;
+    enterRing(1, 0);
+  }
+
+  // Wait for at least one read to complete, and record everything which has. Throws if any failed, once all of the
+  // completions have been taken off the queue. When draining, results are dropped and nothing more is submitted.
+  void waitForCompletions(bool draining = false) {
+    enterRing(0, 1);
+    unsigned head = *cqHead;
+    int error = 0;
+    while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+      const io_uring_cqe& cqe = cqes[head & cqMask];
+      size_t iSlot = static_cast<size_t>(cqe.user_data);
+      int result = cqe.res;
+      head++;
+      __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+      pending--;
+
+      Slot& slot = slots[iSlot];
+      if (draining) {
+        slot.done = true;
+      } else if (result == -EINTR || result == -EAGAIN) {
+        submitRead(iSlot);
+      } else if (result < 0) {
+        slot.done = true;
+        if (error == 0) error = -result;
+      } else if (result == 0) {
+        slot.done = true; // the file ended early
+      } else {
+        slot.filled += static_cast<size_t>(result);
+        if (slot.filled < slot.size) {
+          submitRead(iSlot); // a short read, so ask for the rest
+        } else {
+          slot.done = true;
+        }
+      }
+    }
+    if (error != 0) {
+      throw std::runtime_error("PLY parser: error reading file: " + std::string(std::strerror(error)));
+    }
+  }
+
+  void enterRing(unsigned toSubmit, unsigned minComplete) {
+    unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    while (syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0) < 0) {
+      if (errno != EINTR && errno != EAGAIN) {
+        throw std::runtime_error("PLY parser: error reading file: " + std::string(std::strerror(errno)));
+      }
+    }
+  }
+
+  int ringFd = -1;
+  char* sqRing = nullptr;
+  char* cqRing = nullptr;
+  io_uring_sqe* sqes = nullptr;
+  size_t sqRingBytes = 0;
+  size_t cqRingBytes = 0;
+  size_t sqesBytes = 0;
+  unsigned* sqTail = nullptr;
+  unsigned sqMask = 0;
+  unsigned* sqArray = nullptr;
+  unsigned* cqHead = nullptr;
+  unsigned* cqTail = nullptr;
+  unsigned cqMask = 0;
+  io_uring_cqe* cqes = nullptr;
+  unsigned pending = 0; // reads given to the kernel which have not completed yet
+  std::vector<Slot> slots;
+  std::deque<size_t> inFlight; // slots being read or waiting to be handed out, in file order
+#endif
+
+  std::istream& stream;
+  size_t blockBytes;
+  int fd = -1;
+  uint64_t fileSize = 0;
+  uint64_t position = 0;   // offset in the file of the next byte to hand out
+  uint64_t nextOffset = 0; // offset in the file of the next block to read
+  bool stopped = false;
+  std::unique_ptr<PageCacheDropper> dropper; // drops pages once they are handed out, if asked to
+};
+#endif
+
+
+/**
+ * @brief (reading) Reads a stream in large blocks, and serves the bytes from memory. Works on any stream, including pipes
+ * which cannot seek. If the stream can seek, release() puts it back to just after the bytes which were actually used.
+ * Can also serve bytes which are already in memory, without copying them.
+ */
+class BufferedReader {
+
+public:
+  /**
+   * @brief Prepare to read from a stream, starting at its current position.
+   *
+   * @param stream_ The stream to read from.
+   * @param blockBytes_ Number of bytes to read at a time.
+   * @param prefetch If true, read ahead on a background thread (see StreamPrefetcher). The stream must not be used by
+   * anything else until release() is called.
+   */
+  BufferedReader(std::istream& stream_, size_t blockBytes_ = 1 << 22, bool prefetch = false)
+      : stream(&stream_), blockBytes(std::max<size_t>(blockBytes_, 1)) {
+    if (prefetch) readAhead.reset(new StreamPrefetcher(stream_, blockBytes));
+  }
+
+  /**
+   * @brief Prepare to read from a stream, starting at its current position, with the reads done by something else
+   * (such as a FileReadAhead).
+   *
+   * @param stream_ The stream to read from.
+   * @param blockBytes_ Number of bytes to read at a time.
+   * @param readAhead_ Reads the stream, from its current position.
+   */
+  BufferedReader(std::istream& stream_, size_t blockBytes_, std::unique_ptr<ReadAhead> readAhead_)
+      : stream(&stream_), blockBytes(std::max<size_t>(blockBytes_, 1)), readAhead(std::move(readAhead_)) {}
+
+  /**
+   * @brief Serve bytes directly from memory, which must outlive the reader.
+   *
+   * @param data_ Start of the memory.
+   * @param size_ Number of bytes.
+   * @param blockBytes_ Number of bytes to search at a time when reading lines.
+   */
+  BufferedReader(const char* data_, size_t size_, size_t blockBytes_ = 1 << 22)
+      : stream(nullptr), blockBytes(std::max<size_t>(blockBytes_, 1)), base(data_), end(size_), streamEnded(true) {}
+
+  /**
+   * @brief Pointer to the first buffered byte which has not been used yet.
+   */
+  const char* data() const { return base + begin; }
+
+  /**
+   * @brief Number of buffered bytes which have not been used yet.
+   */
+  size_t size() const { return end - begin; }
+
+  /**
+   * @brief Mark bytes at the start of the buffer as used.
+   *
+   * @param nBytes Number of bytes, at most size().
+   */
+  void consume(size_t nBytes) { begin += nBytes; }
+
+  /**
+   * @brief Make sure that some number of bytes are buffered, reading only as many as are missing.
+   *
+   * @param nBytes Number of bytes needed.
+   *
+   * @return False if the stream ended first, in which case everything up to the end is buffered.
+   */
+  bool fill(size_t nBytes) {
+    if (size() >= nBytes) return true;
+    if (streamEnded) return false;
+
+    // Move the unused bytes to the front, and make room for the rest
+    if (begin > 0) {
+      if (size() > 0) std::memmove(&buffer[0], &buffer[begin], size());
+      end -= begin;
+      begin = 0;
+    }
+    if (buffer.size() < nBytes) buffer.resize(nBytes);
+    base = buffer.data();
+
+    if (readAhead) {
+      end += readAhead->read(&buffer[end], nBytes - end);
+    } else {
+      stream->read(&buffer[end], nBytes - end);
+      end += static_cast<size_t>(stream->gcount());
+    }
+    streamEnded = end < nBytes;
+    return end >= nBytes;
+  }
+
+  /**
+   * @brief Read the next line, like std::getline(), but without copying it out of the buffer.
+   *
+   * @param lineBegin Output, the start of the line.
+   * @param lineEnd Output, the end of the line, not including its newline. The line stays valid until the next call to
+   * fill() (or anything which calls it).
+   *
+   * @return False if there was nothing left to read.
+   */
+  bool readLine(const char*& lineBegin, const char*& lineEnd) {
+    size_t searched = 0;
+    while (true) {
+      if (size() > searched) {
+        const char* newline = static_cast<const char*>(std::memchr(data() + searched, '\n', size() - searched));
+        if (newline != nullptr) {
+          lineBegin = data();
+          lineEnd = newline;
+          consume(newline - data() + 1);
+          return true;
+        }
+        searched = size();
+      }
+
+      if (!fill(size() + blockBytes) && size() == searched) {
+        // The stream ended, so whatever is left is the last line
+        if (size() == 0) return false;
+        lineBegin = data();
+        lineEnd = data() + size();
+        consume(size());
+        return true;
+      }
+    }
+  }
+
+  /**
+   * @brief Stop reading. If the stream can seek, it is put back to just after the bytes which were used; otherwise any
+   * unused bytes are lost.
+   */
+  void release() {
+    if (stream == nullptr) return;
+    size_t nUnused = size();
+    if (readAhead) {
+      nUnused += readAhead->stop();
+      readAhead.reset();
+    }
+    if (nUnused > 0) {
+      stream->clear();
+      stream->seekg(-static_cast<std::streamoff>(nUnused), std::ios::cur);
+    }
+    stream->clear();
+    begin = 0;
+    end = 0;
+  }
+
+private:
+  std::istream* stream; // null when serving memory
+  size_t blockBytes;
+  std::unique_ptr<ReadAhead> readAhead; // does the reading, if not done directly
+  std::vector<char> buffer;
+  const char* base = nullptr; // start of the buffer, or of the memory being served
+  size_t begin = 0;           // first unused byte in the buffer
+  size_t end = 0;             // number of valid bytes in the buffer
+  bool streamEnded = false;
+};
+
+
+/**
+ * @brief (binary reading) Reads the binary records of one element from a stream in large blocks of complete records.
+ * Never reads past the end of the element, so it works for elements with list properties even on streams which cannot
+ * seek.
+ */
+class RecordBlockReader {
+
+public:
+  /**
+   * @brief Prepare to read an element. The source should be positioned at the start of the element's data.
+   *
+   * @param source_ The buffered stream to read from.
+   * @param elem_ The element to read.
+   * @param plan_ The compiled plan for the element, which gives the layout of its records.
+   * @param blockBytes_ Approximate number of bytes to read at a time.
+   * @param nThreads_ Number of threads to use when finding records in each block.
+   */
+  RecordBlockReader(BufferedReader& source_, Element& elem_, const DecodePlan& plan_, size_t blockBytes_ = 1 << 22,
+                    size_t nThreads_ = 1)
+      : source(source_), elem(elem_), plan(plan_), blockBytes(blockBytes_), nThreads(nThreads_),
+        nRemaining(elem_.count), stride(plan_.stride) {}
+
+  /**
+   * @brief Read the next block of records.
+   *
+   * @param maxRecords Largest number of records to put in the block.
+   * @param fullBlock If true, keep reading until the block has maxRecords records (or the rest of the element, if there
+   * are fewer). Otherwise the block has as many records as were found in about blockBytes bytes.
+   *
+   * @return False if there are no more records.
+   */
+  bool next(size_t maxRecords = std::numeric_limits<size_t>::max(), bool fullBlock = false) {
+
+    // Drop the previous block, keeping the start of any partially read record
+    source.consume(blockEnd);
+    blockEnd = 0;
+    blockRecords = 0;
+    maxBlockRecords = std::max<size_t>(maxRecords, 1);
+
+    if (nRemaining == 0) return false;
+
+    // Elements without properties take no space
+    if (plan.steps.empty()) {
+      blockRecords = std::min(nRemaining, maxBlockRecords);
+      nRemaining -= blockRecords;
+      return true;
+    }
+
+    size_t wantRecords = fullBlock ? std::min(nRemaining, maxBlockRecords) : 1;
+    size_t wantBytes = stride > 0 ? std::max(blockBytes, wantRecords * stride) : blockBytes;
+    while (blockRecords < wantRecords) {
+
+      // Read as much as we can without going past the end of the element
+      size_t target = std::min(remainingBytesLowerBound(), wantBytes);
+      if (!source.fill(target)) {
+        throw std::runtime_error("PLY parser: unexpected end of file while reading element " + elem.name);
+      }
+
+      // Find the complete records, reading more if there were not enough
+      if (stride > 0) {
+        blockRecords = std::min(std::min(nRemaining, maxBlockRecords), source.size() / stride);
+        blockEnd = blockRecords * stride;
+      } else {
+        findRecords();
+      }
+      wantBytes = std::max(wantBytes, 2 * source.size());
+    }
+
+    nRemaining -= blockRecords;
+    return true;
+  }
+
+  /**
+   * @brief Pointer to the first record in the current block.
+   */
+  const char* data() const { return source.data(); }
+
+  /**
+   * @brief Number of records in the current block.
+   */
+  size_t size() const { return blockRecords; }
+
+  /**
+   * @brief Number of bytes in the current block.
+   */
+  size_t bytes() const { return blockEnd; }
+
+  /**
+   * @brief Byte offset of each record in the current block, followed by bytes(). Only available for elements with list
+   * properties; for other elements the records are simply every DecodePlan::stride bytes.
+   */
+  const std::vector<size_t>& recordStarts() const { return starts; }
+
+private:
+  /**
+   * @brief Find the complete records at the start of the buffer, and where each one begins. With several threads, the
+   * buffer is split in to chunks which are scanned concurrently. Since records can have any width, where each chunk's
+   * first record begins has to be guessed: we speculate that all records are as wide as the first one (as in a
+   * triangle mesh). Each guess is checked against where the scan of the previous chunk ended, and everything after a
+   * wrong guess is rescanned sequentially.
+   */
+  void findRecords() {
+    const char* begin = source.data();
+    size_t bufferEnd = source.size();
+    const char* end = begin + bufferEnd;
+    const char* pos = begin;
+    size_t maxRecords = std::min(nRemaining, maxBlockRecords);
+    starts.clear();
+
+    const size_t minBytesPerThread = 1 << 20;
+    size_t nChunks = std::min(nThreads, bufferEnd / minBytesPerThread + 1);
+    size_t width = 0;
+    if (nChunks > 1) {
+      const char* firstEnd = begin;
+      scanRecords(firstEnd, end, end, 1, nullptr);
+      width = firstEnd - begin;
+    }
+
+    if (nChunks > 1 && width > 0) {
+      std::vector<size_t> guesses(nChunks + 1, bufferEnd);
+      for (size_t c = 0; c < nChunks; c++) {
+        guesses[c] = std::min(bufferEnd, (bufferEnd * c / nChunks + width - 1) / width * width);
+      }
+
+      std::vector<std::vector<size_t>> chunkStarts(nChunks);
+      std::vector<const char*> chunkEnds(nChunks);
+      parallelFor(nChunks, nChunks, [&](size_t cStart, size_t cEnd) {
+        for (size_t c = cStart; c < cEnd; c++) {
+          const char* chunkPos = begin + guesses[c];
+          scanRecords(chunkPos, begin + guesses[c + 1], end, maxRecords, &chunkStarts[c]);
+          chunkEnds[c] = chunkPos;
+        }
+      });
+
+      for (size_t c = 0; c < nChunks; c++) {
+        if (starts.size() + chunkStarts[c].size() > maxRecords) {
+          // Too many records for one block: end the block at the first one which does not fit
+          chunkStarts[c].resize(maxRecords - starts.size() + 1);
+          pos = begin + chunkStarts[c].back();
+          chunkStarts[c].pop_back();
+          starts.insert(starts.end(), chunkStarts[c].begin(), chunkStarts[c].end());
+          break;
+        }
+        starts.insert(starts.end(), chunkStarts[c].begin(), chunkStarts[c].end());
+        pos = chunkEnds[c];
+        if (c + 1 < nChunks && chunkEnds[c] != begin + guesses[c + 1]) break; // wrong guess
+      }
+    }
+
+    // Sequentially scan anything which is left
+    scanRecords(pos, end, end, maxRecords - starts.size(), &starts);
+
+    blockRecords = starts.size();
+    blockEnd = pos - begin;
+    starts.push_back(blockEnd);
+  }
+
+  /**
+   * @brief Walk over complete records which begin before some point in the buffer.
+   *
+   * @param pos Start of the first record. Advanced past all of the complete records that were found.
+   * @param stop Stop at the first record which begins at or after this point.
+   * @param end End of the valid bytes in the buffer.
+   * @param maxRecords Stop after this many records.
+   * @param recordStarts If not null, the byte offset of each record found is appended here.
+   */
+  void scanRecords(const char*& pos, const char* stop, const char* end, size_t maxRecords,
+                   std::vector<size_t>* recordStarts) {
+    size_t nFound = 0;
+    while (pos < stop && nFound < maxRecords) {
+      size_t width = plan.recordBytes(pos, end);
+      if (width == 0) return;
+      if (recordStarts != nullptr) recordStarts->push_back(pos - source.data());
+      pos += width;
+      nFound++;
+    }
+  }
+
+  /**
+   * @brief A lower bound on the number of bytes from the start of the buffer to the end of the element. The records
+   * found so far are complete, and the one after them may be partially buffered, in which case any list counts it
+   * contains tighten the bound.
+   */
+  size_t remainingBytesLowerBound() {
+    if (stride > 0) return nRemaining * stride;
+
+    size_t nRest = nRemaining - blockRecords;
+    if (nRest == 0) return blockEnd;
+    const char* next = source.data() + blockEnd;
+    return blockEnd + plan.recordBytesLowerBound(next, source.data() + source.size()) +
+           (nRest - 1) * plan.minRecordBytes;
+  }
+
+  BufferedReader& source;
+  Element& elem;
+  const DecodePlan& plan;
+  size_t blockBytes;
+  size_t nThreads;
+  size_t maxBlockRecords = std::numeric_limits<size_t>::max(); // for the current block
+  size_t nRemaining;
+  size_t stride;
+  std::vector<size_t> starts;
+
+  size_t blockEnd = 0;     // number of bytes in the current block
+  size_t blockRecords = 0; // number of records in the current block
+};
+
+
+/**
+ * @brief (binary reading) Decodes the blocks of records from a RecordBlockReader in to properties, using a compiled
+ * plan. Large blocks are decoded in parallel.
+ */
+class BlockDecoder {
+
+public:
+  /**
+   * @brief Prepare to decode an element.
+   *
+   * @param plan_ The compiled plan for the element.
+   * @param destinations_ For each property in the element, the property to decode it in to, or null if it is not
+   * loaded.
+   * @param nThreads_ Number of threads to use.
+   */
+  BlockDecoder(const DecodePlan& plan_, const std::vector<Property*>& destinations_, size_t nThreads_)
+      : plan(plan_), destinations(destinations_), nThreads(nThreads_), nValues(destinations_.size(), 0),
+        targets(destinations_.size()) {}
+
+  /**
+   * @brief Decode the current block of a reader. The destinations must already have room for the records (see
+   * Property::resize()); the values of list properties are added after those which have been decoded already.
+   *
+   * @param reader The reader.
+   * @param iFirst Index of the entry to decode the first record of the block in to.
+   */
+  void decode(const RecordBlockReader& reader, size_t iFirst) {
+    const char* block = reader.data();
+    size_t nRecords = reader.size();
+    size_t nProps = destinations.size();
+
+    if (plan.stride > 0) {
+      // Elements with only fixed-width properties are de-interleaved a property at a time, directly in to pre-sized
+      // storage. The block is split in to chunks of records which are decoded in parallel.
+      bindTargets();
+      const size_t minRecordsPerThread = 1 << 16;
+      size_t nBlockThreads = std::min(nThreads, nRecords / minRecordsPerThread + 1);
+      parallelFor(nRecords, nBlockThreads, [&](size_t iStart, size_t iEnd) {
+        plan.decodeFixedStride(block + iStart * plan.stride, iEnd - iStart, targets.data(), iFirst + iStart);
+      });
+      return;
+    }
+    if (nProps == 0) return; // elements without properties take no space
+
+    // Elements with list properties are decoded in two passes over the block. The first measures the lists in each
+    // chunk of records, so that storage can be sized and every chunk knows where its values go. The second decodes the
+    // chunks in parallel, directly in to place.
+    const std::vector<size_t>& starts = reader.recordStarts();
+    const size_t minRecordsPerThread = 1 << 14;
+    size_t nChunks = std::min(nThreads, nRecords / minRecordsPerThread + 1);
+    auto chunkStart = [&](size_t c) { return nRecords * c / nChunks; };
+
+    // Count the values in each chunk, then convert to the index of each chunk's first value
+    std::vector<size_t> chunkValues(nChunks * nProps, 0);
+    parallelFor(nChunks, nChunks, [&](size_t cStart, size_t cEnd) {
+      for (size_t c = cStart; c < cEnd; c++) {
+        plan.countValues(block + starts[chunkStart(c)], chunkStart(c + 1) - chunkStart(c), &chunkValues[c * nProps]);
+      }
+    });
+    for (size_t iP = 0; iP < nProps; iP++) {
+      for (size_t c = 0; c < nChunks; c++) {
+        size_t chunkCount = chunkValues[c * nProps + iP];
+        chunkValues[c * nProps + iP] = nValues[iP];
+        nValues[iP] += chunkCount;
+      }
+      if (destinations[iP] != nullptr && plan.steps[iP].countBytes > 0) {
+        destinations[iP]->resizeValues(nValues[iP]);
+      }
+    }
+    bindTargets();
+
+    // Decode each chunk
+    parallelFor(nChunks, nChunks, [&](size_t cStart, size_t cEnd) {
+      for (size_t c = cStart; c < cEnd; c++) {
+        plan.decodeRecords(block + starts[chunkStart(c)], chunkStart(c + 1) - chunkStart(c), targets.data(),
+                           iFirst + chunkStart(c), &chunkValues[c * nProps]);
+      }
+    });
+  }
+
+  /**
+   * @brief Forget the list values decoded so far, so that the next block's values are decoded from the start of the
+   * destinations' storage. Used when the destinations are reused for each block.
+   */
+  void resetValues() { std::fill(nValues.begin(), nValues.end(), 0); }
+
+  /**
+   * @brief Decode a scalar property straight in to memory, rather than in to a destination property.
+   *
+   * @param iP Index of the property in the element.
+   * @param values Where to decode the value of the first record. Must have room for every record.
+   * @param valueStride Number of bytes between the values of consecutive records.
+   */
+  void bindMemory(size_t iP, char* values, size_t valueStride) {
+    destinations[iP] = nullptr;
+    targets[iP].values = values;
+    targets[iP].valueStride = valueStride;
+  }
+
+private:
+  // Point the plan's targets at the current storage of each destination
+  void bindTargets() {
+    for (size_t iP = 0; iP < destinations.size(); iP++) {
+      if (destinations[iP] == nullptr) continue;
+      targets[iP].values = destinations[iP]->valueStorage();
+      targets[iP].listStarts = destinations[iP]->listStartStorage();
+    }
+  }
+
+  const DecodePlan& plan;
+  std::vector<Property*> destinations;
+  size_t nThreads;
+  std::vector<size_t> nValues; // number of list values decoded so far, for each property
+  std::vector<DecodePlan::Target> targets;
+};
+
+
+/**
+ * @brief A read-only memory mapping of an entire file. Closes the mapping when destroyed.
+ */
+class MappedFile {
+
+public:
+  /**
+   * @brief Map a file in to memory. Throws if any failures occur.
+   *
+   * @param filename The file to map.
+   */
+  MappedFile(const std::string& filename) {
+#if defined(_WIN32)
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error("PLY parser: Could not open file " + filename);
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+      CloseHandle(fileHandle);
+      throw std::runtime_error("PLY parser: Could not get size of file " + filename);
+    }
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+    if (mappedSize > 0) {
+      mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (mapHandle != NULL) {
+        mappedData = static_cast<const char*>(MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0));
+      }
+      if (mappedData == nullptr) {
+        if (mapHandle != NULL) CloseHandle(mapHandle);
+        CloseHandle(fileHandle);
+        throw std::runtime_error("PLY parser: Could not map file " + filename);
+      }
+    }
+#else
+    fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("PLY parser: Could not open file " + filename);
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+      close(fd);
+      throw std::runtime_error("PLY parser: Could not get size of file " + filename);
+    }
+    mappedSize = static_cast<size_t>(fileStat.st_size);
+    if (mappedSize > 0) {
+      void* ptr = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (ptr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("PLY parser: Could not map file " + filename);
+      }
+      mappedData = static_cast<const char*>(ptr);
+    }
+#endif
+  }
+
+  ~MappedFile() {
+#if defined(_WIN32)
+    if (mappedData != nullptr) UnmapViewOfFile(mappedData);
+    if (mapHandle != NULL) CloseHandle(mapHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+#else
+    if (mappedData != nullptr) munmap(const_cast<char*>(mappedData), mappedSize);
+    if (fd >= 0) close(fd);
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+   * @brief The mapped bytes.
+   */
+  const char* data() const { return mappedData; }
+
+  /**
+   * @brief The number of mapped bytes (the size of the file).
+   */
+  size_t size() const { return mappedSize; }
+
+private:
+  const char* mappedData = nullptr;
+  size_t mappedSize = 0;
+#if defined(_WIN32)
+  HANDLE fileHandle = INVALID_HANDLE_VALUE;
+  HANDLE mapHandle = NULL;
+#else
+  int fd = -1;
+#endif
+};
+
+/**
+ * @brief A file of a given size, created and mapped in to memory for writing. Unmaps and closes the file when destroyed.
+ */
+class MappedOutputFile {
+
+public:
+  /**
+   * @brief Create a file, replacing any that exists, and map it in to memory. Throws if any failures occur.
+   *
+   * @param filename The file to create.
+   * @param size_ The size of the file, in bytes.
+   */
+  MappedOutputFile(const std::string& filename, size_t size_) : mappedSize(size_) {
+#if defined(_WIN32)
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error("Ply writer: Could not open output file " + filename + " for writing");
+    }
+    if (mappedSize > 0) {
+      uint64_t size64 = mappedSize;
+      mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32),
+                                     static_cast<DWORD>(size64 & 0xFFFFFFFFu), NULL);
+      if (mapHandle != NULL) {
+        mappedData = static_cast<char*>(MapViewOfFile(mapHandle, FILE_MAP_WRITE, 0, 0, 0));
+      }
+      if (mappedData == nullptr) {
+        if (mapHandle != NULL) CloseHandle(mapHandle);
+        CloseHandle(fileHandle);
+        throw std::runtime_error("Ply writer: Could not map output file " + filename);
+      }
+    }
+#else
+    fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      throw std::runtime_error("Ply writer: Could not open output file " + filename + " for writing");
+    }
+    // Allocate the blocks up front, so that running out of space throws here rather than raising SIGBUS when the
+    // mapping is written. Where the file system can not do that, the file is only sized.
+    bool sized = false;
+    if (mappedSize > 0) {
+#if defined(__APPLE__)
+      // Only reserves the blocks, the size is still set below
+      fstore_t store = {F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(mappedSize), 0};
+      int allocError = fcntl(fd, F_PREALLOCATE, &store) == -1 ? errno : 0;
+#else
+      int allocError = posix_fallocate(fd, 0, static_cast<off_t>(mappedSize));
+      sized = allocError == 0;
+#endif
+      if (allocError != 0 && allocError != EOPNOTSUPP && allocError != ENOTSUP) {
+        close(fd);
+        throw std::runtime_error("Ply writer: Could not allocate " + std::to_string(mappedSize) +
+                                 " bytes for output file " + filename + ": " + std::strerror(allocError));
+      }
+    }
+    if (!sized && ftruncate(fd, static_cast<off_t>(mappedSize)) != 0) {
+      close(fd);
+      throw std::runtime_error("Ply writer: Could not set the size of output file " + filename);
+    }
+    if (mappedSize > 0) {
+      void* ptr = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (ptr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Ply writer: Could not map output file " + filename);
+      }
+      mappedData = static_cast<char*>(ptr);
+    }
+#endif
+  }
+
+  ~MappedOutputFile() {
+#if defined(_WIN32)
+    if (mappedData != nullptr) UnmapViewOfFile(mappedData);
+    if (mapHandle != NULL) CloseHandle(mapHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+#else
+    if (mappedData != nullptr) munmap(mappedData, mappedSize);
+    if (fd >= 0) close(fd);
+#endif
+  }
+
+  MappedOutputFile(const MappedOutputFile&) = delete;
+  MappedOutputFile& operator=(const MappedOutputFile&) = delete;
+
+  /**
+   * @brief The mapped bytes.
+   */
+  char* data() { return mappedData; }
+
+  /**
+   * @brief The number of mapped bytes (the size of the file).
+   */
+  size_t size() const { return mappedSize; }
+
+  /**
+   * @brief Write a range of the file back to disk, and drop it from the page cache (see PageCacheMode::DropBehind).
+   * The range can still be written to afterwards; it is just read back in.
+   *
+   * @param begin Offset of the start of the range.
+   * @param end Offset of the end of the range.
+   */
+  void dropFromPageCache(size_t begin, size_t end) {
+#if !defined(_WIN32)
+    size_t pageBytes = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    begin -= begin % pageBytes;
+    if (end <= begin) return;
+    msync(mappedData + begin, end - begin, MS_SYNC);
+    madvise(mappedData + begin, end - begin, MADV_DONTNEED);
+    PageCacheDropper::drop(fd, begin, end);
+#endif
+  }
+
+private:
+  char* mappedData = nullptr;
+  size_t mappedSize = 0;
+#if defined(_WIN32)
+  HANDLE fileHandle = INVALID_HANDLE_VALUE;
+  HANDLE mapHandle = NULL;
+#else
+  int fd = -1;
+#endif
+};
+
+/**
+ * @brief A streambuf which reads directly from a range of memory without copying it, so that the usual stream-based
+ * parsing can be applied to in-memory data.
+ */
+class MemoryStreamBuf : public std::streambuf {
+
+public:
+  /**
+   * @brief Create a streambuf over some memory. The memory must outlive the streambuf.
+   *
+   * @param data_ Start of the memory.
+   * @param size_ Number of bytes.
+   */
+  MemoryStreamBuf(const char* data_, size_t size_) {
+    char* begin = const_cast<char*>(data_); // never written through
+    setg(begin, begin, begin + size_);
+  }
+
+  /**
+   * @brief Number of bytes read so far. Unlike tellg(), this is still valid once the stream has hit the end.
+   */
+  size_t consumed() const { return static_cast<size_t>(gptr() - eback()); }
+
+protected:
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+    char* target = nullptr;
+    if (dir == std::ios_base::beg) {
+      target = eback() + off;
+    } else if (dir == std::ios_base::cur) {
+      target = gptr() + off;
+    } else {
+      target = egptr() + off;
+    }
+    if (!(which & std::ios_base::in) || target < eback() || target > egptr()) return pos_type(off_type(-1));
+    setg(eback(), target, egptr());
+    return pos_type(target - eback());
+  }
+
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+};
+
+
+/**
+ * @brief Primary class; represents a set of data in the .ply format.
+ */
+class PLYData {
+
+public:
+  /**
+   * @brief Create an empty PLYData object.
+   */
+  PLYData(){};
+
+  /**
+   * @brief Initialize a PLYData by reading from a file. Throws if any failures occur.
+   *
+   * @param filename The file to read from.
+   * @param verbose If true, print useful info about the file to stdout
+   */
+  PLYData(const std::string& filename, bool verbose = false) {
+    ReadOptions options;
+    options.verbose = verbose;
+    readFile(filename, options);
+  }
+
+  /**
+   * @brief Initialize a PLYData by reading from a file. Throws if any failures occur.
+   *
+   * @param filename The file to read from.
+   * @param options Options controlling how the file is read.
+   */
+  PLYData(const std::string& filename, const ReadOptions& options) { readFile(filename, options); }
+
+  /**
+   * @brief Initialize a PLYData by reading from a stringstream. Throws if any failures occur.
+   *
+   * @param inStream The stringstream to read from.
+   * @param verbose If true, print useful info about the file to stdout
+   */
+  PLYData(std::istream& inStream, bool verbose = false) {
+    ReadOptions options;
+    options.verbose = verbose;
+    readStream(inStream, options);
+  }
+
+  /**
+   * @brief Initialize a PLYData by reading from a stringstream. Throws if any failures occur.
+   *
+   * @param inStream The stringstream to read from.
+   * @param options Options controlling how the stream is read. Lazy loading is not supported for streams.
+   */
+  PLYData(std::istream& inStream, const ReadOptions& options) { readStream(inStream, options); }
+
+  /**
+   * @brief Initialize a PLYData by parsing a whole file which is already in memory, without copying it or going through
+   * a stream. Throws if any failures occur.
+   *
+   * @param data Start of the file's bytes.
+   * @param size Number of bytes.
+   * @param options Options controlling how the data is read. Lazy loading is not supported for memory.
+   */
+  PLYData(const void* data, size_t size, const ReadOptions& options) { readMemory(data, size, options); }
+
+  /**
+   * @brief Perform sanity checks on the file, throwing if any fail.
+   */
+  void validate() {
+
+    loadAllElements();
+
+    for (size_t iE = 0; iE < elements.size(); iE++) {
+      for (char c : elements[iE].name) {
+        if (std::isspace(c)) {
+          throw std::runtime_error("Ply validate: illegal whitespace in element name " + elements[iE].name);
+        }
+      }
+      for (size_t jE = iE + 1; jE < elements.size(); jE++) {
+        if (elements[iE].name == elements[jE].name) {
+          throw std::runtime_error("Ply validate: duplcate element name " + elements[iE].name);
+        }
+      }
+    }
+
+    // Do a quick validation sanity check
+    for (Element& e : elements) {
+      e.validate();
+    }
+  }
+
+  /**
+   * @brief Write this data to a .ply file.
+   *
+   * @param filename The file to write to.
+   * @param format The format to use (binary or ascii?)
+   */
+  void write(const std::string& filename, DataFormat format = DataFormat::ASCII) {
+    write(filename, format, WriteOptions());
+  }
+
+  /**
+   * @brief Write this data to a .ply file.
+   *
+   * @param filename The file to write to.
+   * @param format The format to use (binary or ascii?)
+   * @param options Options controlling how the file is written.
+   */
+  void write(const std::string& filename, DataFormat format, const WriteOptions& options) {
+    outputDataFormat = format;
+
+    validate();
+
+    // Binary files can be written by several threads at once, straight in to the file
+    if (format != DataFormat::ASCII && resolveThreadCount(options.threads) > 1) {
+      writeBinaryParallel(filename, resolveThreadCount(options.threads), options.pageCache);
+      return;
+    }
+
+    // Open stream for writing
+    std::ofstream outStream(filename, std::ios::out | std::ios::binary);
+    if (!outStream.good()) {
+      throw std::runtime_error("Ply writer: Could not open output file " + filename + " for writing");
+    }
+
+#if !defined(_WIN32)
+    // Push each block out of the page cache once the stream has passed it on
+    if (options.pageCache == PageCacheMode::DropBehind) {
+      PageCacheDropper dropper(filename);
+      writePLY(outStream, options, [&]() {
+        outStream.flush();
+        dropper.advance(static_cast<uint64_t>(outStream.tellp()));
+      });
+      outStream.flush();
+      dropper.finish(static_cast<uint64_t>(outStream.tellp()));
+      return;
+    }
+#endif
+
+    writePLY(outStream, options);
+  }
+
+  /**
+   * @brief Write this data to an output stream
+   *
+   * @param outStream The output stream to write to.
+   * @param format The format to use (binary or ascii?)
+   */
+  void write(std::ostream& outStream, DataFormat format = DataFormat::ASCII) {
+    write(outStream, format, WriteOptions());
+  }
+
+  /**
+   * @brief Write this data to an output stream
+   *
+   * @param outStream The output stream to write to.
+   * @param format The format to use (binary or ascii?)
+   * @param options Options controlling how the data is written.
+   */
+  void write(std::ostream& outStream, DataFormat format, const WriteOptions& options) {
+    outputDataFormat = format;
+
+    validate();
+
+    writePLY(outStream, options);
+  }
+
+  /**
+   * @brief Get an element type by name ("vertices")
+   *
+   * @param target The name of the element type to get
+   *
+   * @return A reference to the element type.
+   */
+  Element& getElement(const std::string& target) {
+    for (size_t iE = 0; iE < elements.size(); iE++) {
+      if (elements[iE].name == target) {
+        for (size_t iFile = 0; iFile < elementLoaded.size(); iFile++) {
+          if (fileOrder[iFile] == static_cast<long>(iE) && !elementLoaded[iFile]) loadElement(iFile);
+        }
+        return elements[iE];
+      }
+    }
+    throw std::runtime_error("PLY parser: no element with name: " + target);
+  }
+
+
+  /**
+   * @brief Check if an element type exists
+   *
+   * @param target The name to check for.
+   *
+   * @return True if exists.
+   */
+  bool hasElement(const std::string& target) {
+    for (Element& e : elements) {
+      if (e.name == target) return true;
+    }
+    return false;
+  }
+
+
+  /**
+   * @brief A list of the names of all elements
+   *
+   * @return Element names
+   */
+  std::vector<std::string> getElementNames() {
+    std::vector<std::string> names;
+    for (Element& e : elements) {
+      names.push_back(e.name);
+    }
+    return names;
+  }
+
+
+  /**
+   * @brief Add a new element type to the object
+   *
+   * @param name The name of the new element type ("vertices").
+   * @param count The number of elements of this type.
+   */
+  void addElement(const std::string& name, size_t count) { elements.emplace_back(name, count); }
+
+  // === Common-case helpers
+
+
+  /**
+   * @brief Common-case helper get mesh vertex positions
+   *
+   * @param vertexElementName The element name to use (default: "vertex")
+   *
+   * @return A vector of vertex positions.
+   */
+  std::vector<std::array<double, 3>> getVertexPositions(const std::string& vertexElementName = "vertex") {
+
+    std::vector<double> xPos = getElement(vertexElementName).getProperty<double>("x");
+    std::vector<double> yPos = getElement(vertexElementName).getProperty<double>("y");
+    std::vector<double> zPos = getElement(vertexElementName).getProperty<double>("z");
+
+    std::vector<std::array<double, 3>> result(xPos.size());
+    for (size_t i = 0; i < result.size(); i++) {
+      result[i][0] = xPos[i];
+      result[i][1] = yPos[i];
+      result[i][2] = zPos[i];
+    }
+
+    return result;
+  }
+
+  /**
+   * @brief Common-case helper get mesh vertex colors
+   *
+   * @param vertexElementName The element name to use (default: "vertex")
+   *
+   * @return A vector of vertex colors (unsigned chars [0,255]).
+   */
+  std::vector<std::array<unsigned char, 3>> getVertexColors(const std::string& vertexElementName = "vertex") {
+
+    std::vector<unsigned char> r = getElement(vertexElementName).getProperty<unsigned char>("red");
+    std::vector<unsigned char> g = getElement(vertexElementName).getProperty<unsigned char>("green");
+    std::vector<unsigned char> b = getElement(vertexElementName).getProperty<unsigned char>("blue");
+
+    std::vector<std::array<unsigned char, 3>> result(r.size());
+    for (size_t i = 0; i < result.size(); i++) {
+      result[i][0] = r[i];
+      result[i][1] = g[i];
+      result[i][2] = b[i];
+    }
+
+    return result;
+  }
+
+  /**
+   * @brief Common-case helper to get face indices for a mesh. If not template type is given, size_t is used. Naively
+   * converts to requested signedness, which may lead to unexpected values if an unsigned type is used and file contains
+   * negative values.
+   *
+   * @return The indices into the vertex elements for each face. Usually 0-based, though there are no formal rules.
    */
-  template <class D, class T>
-  std::vector<std::vector<D>> getDataFromListPropertyRecursive(Property* prop) {
-    typedef typename CanonicalName<T>::type Tcan;
+  template <typename T = size_t>
+  std::vector<std::vector<T>> getFaceIndices() {
 
-    TypedListProperty<Tcan>* castedProp = dynamic_cast<TypedListProperty<Tcan>*>(prop);
-    if (castedProp) {
-      // Succeeded, return a buffer of the data (copy while converting type)
+    for (const std::string& f : std::vector<std::string>{"face"}) {
+      for (const std::string& p : std::vector<std::string>{"vertex_indices", "vertex_index"}) {
+        try {
+          return getElement(f).getListPropertyAnySign<T>(p);
+        } catch (const std::runtime_error&) {
+          // that's fine
+        }
+      }
+    }
+    throw std::runtime_error("PLY parser: could not find face vertex indices attribute under any common name.");
+  }
 
-      // Convert to flat buffer of new type
-      std::vector<D>* castedFlatVec = nullptr;
-      std::vector<D> castedFlatVecCopy; // we _might_ make a copy here, depending on is_same below
+  /**
+   * @brief Like getFaceIndices(), but returns the indices in flat (CSR) form, which avoids an allocation per face.
+   *
+   * @return The indices into the vertex elements for each face, back to back, with the offset where each face begins.
+   */
+  template <typename T = size_t>
+  FlatList<T> getFaceIndicesFlat() {
 
-      if (std::is_same<std::vector<D>, std::vector<Tcan>>::value) {
-        // just use the array we already have
-        castedFlatVec = addressIfSame<std::vector<D>>(castedProp->flattenedData, 0 /* dummy arg to disambiguate */);
-      } else {
-        // make a copy
-        castedFlatVecCopy.reserve(castedProp->flattenedData.size());
-        for (Tcan& v : castedProp->flattenedData) {
-          castedFlatVecCopy.push_back(static_cast<D>(v));
+    for (const std::string& f : std::vector<std::string>{"face"}) {
+      for (const std::string& p : std::vector<std::string>{"vertex_indices", "vertex_index"}) {
+        try {
+          return getElement(f).getListPropertyFlatAnySign<T>(p);
+        } catch (const std::runtime_error&) {
+          // that's fine
         }
-        castedFlatVec = &castedFlatVecCopy;
       }
+    }
+    throw std::runtime_error("PLY parser: could not find face vertex indices attribute under any common name.");
+  }
+
+
+  /**
+   * @brief Common-case helper set mesh vertex positons. Creates vertex element, if necessary.
+   *
+   * @param vertexPositions A vector of vertex positions
+   */
+  void addVertexPositions(std::vector<std::array<double, 3>>& vertexPositions) {
+
+    std::string vertexName = "vertex";
+    size_t N = vertexPositions.size();
+
+    // Create the element
+    if (!hasElement(vertexName)) {
+      addElement(vertexName, N);
+    }
+
+    // De-interleave
+    std::vector<double> xPos(N);
+    std::vector<double> yPos(N);
+    std::vector<double> zPos(N);
+    for (size_t i = 0; i < vertexPositions.size(); i++) {
+      xPos[i] = vertexPositions[i][0];
+      yPos[i] = vertexPositions[i][1];
+      zPos[i] = vertexPositions[i][2];
+    }
+
+    // Store
+    getElement(vertexName).addProperty<double>("x", xPos);
+    getElement(vertexName).addProperty<double>("y", yPos);
+    getElement(vertexName).addProperty<double>("z", zPos);
+  }
+
+  /**
+   * @brief Common-case helper set mesh vertex colors. Creates a vertex element, if necessary.
+   *
+   * @param colors A vector of vertex colors (unsigned chars [0,255]).
+   */
+  void addVertexColors(std::vector<std::array<unsigned char, 3>>& colors) {
+
+    std::string vertexName = "vertex";
+    size_t N = colors.size();
+
+    // Create the element
+    if (!hasElement(vertexName)) {
+      addElement(vertexName, N);
+    }
+
+    // De-interleave
+    std::vector<unsigned char> r(N);
+    std::vector<unsigned char> g(N);
+    std::vector<unsigned char> b(N);
+    for (size_t i = 0; i < colors.size(); i++) {
+      r[i] = colors[i][0];
+      g[i] = colors[i][1];
+      b[i] = colors[i][2];
+    }
+
+    // Store
+    getElement(vertexName).addProperty<unsigned char>("red", r);
+    getElement(vertexName).addProperty<unsigned char>("green", g);
+    getElement(vertexName).addProperty<unsigned char>("blue", b);
+  }
+
+  /**
+   * @brief Common-case helper set mesh vertex colors. Creates a vertex element, if necessary.
+   *
+   * @param colors A vector of vertex colors as floating point [0,1] values. Internally converted to [0,255] chars.
+   */
+  void addVertexColors(std::vector<std::array<double, 3>>& colors) {
+
+    std::string vertexName = "vertex";
+    size_t N = colors.size();
+
+    // Create the element
+    if (!hasElement(vertexName)) {
+      addElement(vertexName, N);
+    }
+
+    auto toChar = [](double v) {
+      if (v < 0.0) v = 0.0;
+      if (v > 1.0) v = 1.0;
+      return static_cast<unsigned char>(v * 255.);
+    };
+
+    // De-interleave
+    std::vector<unsigned char> r(N);
+    std::vector<unsigned char> g(N);
+    std::vector<unsigned char> b(N);
+    for (size_t i = 0; i < colors.size(); i++) {
+      r[i] = toChar(colors[i][0]);
+      g[i] = toChar(colors[i][1]);
+      b[i] = toChar(colors[i][2]);
+    }
+
+    // Store
+    getElement(vertexName).addProperty<unsigned char>("red", r);
+    getElement(vertexName).addProperty<unsigned char>("green", g);
+    getElement(vertexName).addProperty<unsigned char>("blue", b);
+  }
+
+
+  /**
+   * @brief Common-case helper to set face indices. Creates a face element if needed. The input type will be casted to a
+   * 32 bit integer of the same signedness.
+   *
+   * @param indices The indices into the vertex list around each face.
+   */
+  template <typename T>
+  void addFaceIndices(std::vector<std::vector<T>>& indices) {
+
+    std::string faceName = "face";
+    size_t N = indices.size();
+
+    // Create the element
+    if (!hasElement(faceName)) {
+      addElement(faceName, N);
+    }
+
+    // Cast to 32 bit
+    typedef typename std::conditional<std::is_signed<T>::value, int32_t, uint32_t>::type IndType;
+    std::vector<std::vector<IndType>> intInds;
+    for (std::vector<T>& l : indices) {
+      std::vector<IndType> thisInds;
+      for (T& val : l) {
+        IndType valConverted = static_cast<IndType>(val);
+        if (valConverted != val) {
+          throw std::runtime_error("Index value " + std::to_string(val) +
+                                   " could not be converted to a .ply integer without loss of data. Note that .ply "
+                                   "only supports 32-bit ints.");
+        }
+        thisInds.push_back(valConverted);
+      }
+      intInds.push_back(thisInds);
+    }
+
+    // Store
+    getElement(faceName).addListProperty<IndType>("vertex_indices", intInds);
+  }
+
+
+  /**
+   * @brief Comments for the file. When writing, each entry will be written as a sequential comment line.
+   */
+  std::vector<std::string> comments;
+
+
+  /**
+   * @brief obj_info comments for the file. When writing, each entry will be written as a sequential comment line.
+   */
+  std::vector<std::string> objInfoComments;
+
+private:
+  friend class PLYView;   // reuses the header parser
+  friend class PLYReader; // reuses the header parser and element decoding
+  friend class PLYWriter; // reuses the header and element writers
+
+  std::vector<Element> elements;
+  const int majorVersion = 1; // I'll buy you a drink if these ever get bumped
+  const int minorVersion = 0;
+
+  DataFormat inputDataFormat = DataFormat::ASCII;  // set when reading from a file
+  DataFormat outputDataFormat = DataFormat::ASCII; // option for writing files
+
+
+  // State used while reading, cleared once reading is finished (for lazy loading, once every element is loaded)
+  ReadOptions readOptions; // the options for the read in progress
+  std::vector<Element> skippedElements; // elements in the file which are not being loaded (but must be read past)
+  std::vector<long> fileOrder; // element at each position in the file: elements[i] if i >= 0, else skippedElements[-1-i]
+
+  /**
+   * @brief Scratch space for parsing ASCII records in parallel, kept between calls so that reading an element in
+   * batches (see PLYReader) does not reallocate it for every batch.
+   */
+  struct ASCIIStaging {
+    const Element* elem = nullptr; // the element the staging properties were made for
+    std::vector<bool> loaded;      // which of its properties they were made for
+    std::vector<std::vector<std::unique_ptr<Property>>> properties; // for each thread, its properties
+    std::vector<std::vector<Property*>> destinations; // for each thread, where each property is parsed to (or null)
+    std::vector<const char*> lineBegins;
+    std::vector<const char*> lineEnds;
+    std::vector<size_t> chunkValues;
+    std::vector<size_t> firstEntry;
+  };
+  ASCIIStaging asciiStaging;
+
+  // State for lazy loading (see ReadOptions::lazy), indexed by position in the file
+  std::unique_ptr<std::istream> lazyStream; // the open file
+  std::vector<std::streampos> elementStarts; // where each element begins in the file, as far as is known yet
+  std::vector<bool> elementLoaded;
+
+
+  // === Reading ===
+
+  /**
+   * @brief Read from a file.
+   *
+   * @param filename
+   * @param options
+   */
+  void readFile(const std::string& filename, const ReadOptions& options) {
+
+    using std::cout;
+    using std::endl;
+
+    if (options.verbose) cout << "PLY parser: Reading ply file: " << filename << endl;
+
+    // Open a file in binary always, in case it turns out to have binary data.
+    std::unique_ptr<std::ifstream> inStream(new std::ifstream(filename, std::ios::binary));
+    if (inStream->fail()) {
+      throw std::runtime_error("PLY parser: Could not open file " + filename);
+    }
+
+    if (options.lazy) {
+      // Parse just the header, and hold on to the file to read elements later
+      parseHeader(*inStream, options.verbose);
+      applyReadOptions(options);
+      elementStarts.push_back(inStream->tellg());
+      for (long iElem : fileOrder) {
+        elementLoaded.push_back(iElem < 0); // skipped elements never need to be loaded
+      }
+      lazyStream = std::move(inStream);
+      if (options.verbose) cout << "  - Finished parsing header, elements will be loaded lazily." << endl;
+      loadElementsIfDone();
+      return;
+    }
+
+    parsePLY(*inStream, options, filename);
+
+    if (options.verbose) {
+      cout << "  - Finished parsing file." << endl;
+    }
+  }
 
-      // Unflatten and return
-      return unflattenList(*castedFlatVec, castedProp->flattenedIndexStart);
+  /**
+   * @brief Read from a stream.
+   *
+   * @param inStream
+   * @param options
+   */
+  void readStream(std::istream& inStream, const ReadOptions& options) {
+
+    using std::cout;
+    using std::endl;
+
+    if (options.lazy) {
+      throw std::runtime_error("PLY parser: lazy loading is only supported when reading from a file");
     }
 
-    TypeChain<Tcan> chainType;
-    if (chainType.hasChildType) {
-      return getDataFromListPropertyRecursive<D, typename TypeChain<Tcan>::type>(prop);
-    } else {
-      // No smaller type to try, failure
-      throw std::runtime_error("PLY parser: list property " + prop->name +
-                               " cannot be coerced to requested type list " + typeName<D>() + ". Has type list " +
-                               prop->propertyTypeName());
+    if (options.verbose) cout << "PLY parser: Reading ply file from stream" << endl;
+
+    parsePLY(inStream, options);
+
+    if (options.verbose) {
+      cout << "  - Finished parsing stream." << endl;
     }
   }
-};
 
+  /**
+   * @brief Read from memory.
+   *
+   * @param data
+   * @param size
+   * @param options
+   */
+  void readMemory(const void* data, size_t size, const ReadOptions& options) {
 
-// Some string helpers
-namespace {
+    using std::cout;
+    using std::endl;
 
-inline std::string trimSpaces(const std::string& input) {
-  size_t start = 0;
-  while (start < input.size() && input[start] == ' ') start++;
-  size_t end = input.size();
-  while (end > start && (input[end - 1] == ' ' || input[end - 1] == '\n' || input[end - 1] == '\r')) end--;
-  return input.substr(start, end - start);
-}
+    if (options.lazy) {
+      throw std::runtime_error("PLY parser: lazy loading is only supported when reading from a file");
+    }
 
-inline std::vector<std::string> tokenSplit(const std::string& input) {
-  std::vector<std::string> result;
-  size_t curr = 0;
-  size_t found = 0;
-  while ((found = input.find_first_of(' ', curr)) != std::string::npos) {
-    std::string token = input.substr(curr, found - curr);
-    token = trimSpaces(token);
-    if (token.size() > 0) {
-      result.push_back(token);
+    if (options.verbose) cout << "PLY parser: Reading ply file from memory" << endl;
+
+    // Parse the header in place, then the elements straight from the bytes which follow it
+    const char* bytes = static_cast<const char*>(data);
+    MemoryStreamBuf headerBuf(bytes, size);
+    std::istream headerStream(&headerBuf);
+    parseHeader(headerStream, options.verbose);
+    applyReadOptions(options);
+    size_t headerBytes = headerBuf.consumed();
+    BufferedReader source(bytes + headerBytes, size - headerBytes, readOptions.bufferBytes);
+    parseElements(source);
+
+    if (options.verbose) {
+      cout << "  - Finished parsing memory." << endl;
     }
-    curr = found + 1;
   }
-  std::string token = input.substr(curr);
-  token = trimSpaces(token);
-  if (token.size() > 0) {
-    result.push_back(token);
+
+  /**
+   * @brief Parse a PLY file from an input stream
+   *
+   * @param inStream
+   * @param options
+   * @param filename The file the stream is open on, if it is one (see ReadOptions::asyncIO).
+   */
+  void parsePLY(std::istream& inStream, const ReadOptions& options, const std::string& filename = "") {
+
+    // == Process the header
+    parseHeader(inStream, options.verbose);
+    applyReadOptions(options);
+
+    // == Parse data for each element
+#if !defined(_WIN32)
+    if ((readOptions.asyncIO || readOptions.pageCache != PageCacheMode::Default) && !filename.empty()) {
+      std::unique_ptr<ReadAhead> fileReads(new FileReadAhead(filename, inStream, readOptions.bufferBytes, 4,
+                                                             readOptions.asyncIO, readOptions.pageCache));
+      BufferedReader source(inStream, readOptions.bufferBytes, std::move(fileReads));
+      parseElements(source);
+      return;
+    }
+#endif
+    BufferedReader source(inStream, readOptions.bufferBytes, readOptions.prefetch);
+    parseElements(source);
   }
 
-  return result;
-}
+  /**
+   * @brief Parse the data for every element, after the header has been parsed and the read options applied.
+   *
+   * @param source The data, positioned just after the header.
+   */
+  void parseElements(BufferedReader& source) {
+    if (inputDataFormat != DataFormat::ASCII && !isLittleEndian()) {
+      throw std::runtime_error("binary reading assumes little endian system");
+    }
+    for (size_t iFile = 0; iFile < fileOrder.size(); iFile++) {
+      if (readOptions.verbose) {
+        std::cout << "  - " << (fileOrder[iFile] >= 0 ? "Processing" : "Skipping") << " element: "
+                  << fileElement(iFile).name << std::endl;
+      }
+      parseElement(source, iFile);
+    }
+    source.release();
 
-inline bool startsWith(const std::string& input, const std::string& query) {
-  return input.compare(0, query.length(), query) == 0;
-}
-}; // namespace
+    finishReading();
+  }
 
+  /**
+   * @brief Set up the elements to read after parsing the header, moving any elements which will not be loaded out of
+   * the elements list (see ReadOptions::projection).
+   *
+   * @param options The options for this read.
+   */
+  void applyReadOptions(const ReadOptions& options) {
+    readOptions = options;
+    readOptions.threads = resolveThreadCount(options.threads);
+    const std::map<std::string, std::vector<std::string>>& projection = readOptions.projection;
+    std::vector<Element> fileElements;
+    fileElements.swap(elements);
+    for (Element& elem : fileElements) {
+      if (projection.empty() || projection.count(elem.name) > 0) {
+        fileOrder.push_back(static_cast<long>(elements.size()));
+        elements.push_back(std::move(elem));
+      } else {
+        fileOrder.push_back(-1 - static_cast<long>(skippedElements.size()));
+        skippedElements.push_back(std::move(elem));
+      }
+    }
+  }
 
-/**
- * @brief Primary class; represents a set of data in the .ply format.
- */
-class PLYData {
+  /**
+   * @brief Clear state which is only needed while reading.
+   */
+  void finishReading() {
+    readOptions = ReadOptions();
+    skippedElements.clear();
+    fileOrder.clear();
+    asciiStaging = ASCIIStaging();
+    lazyStream.reset();
+    elementStarts.clear();
+    elementLoaded.clear();
+  }
 
-public:
   /**
-   * @brief Create an empty PLYData object.
+   * @brief The element at some position in the file being read (which may or may not be loaded).
+   *
+   * @param iFile Position of the element in the file.
+   *
+   * @return The element.
    */
-  PLYData(){};
+  Element& fileElement(size_t iFile) {
+    long iElem = fileOrder[iFile];
+    return iElem >= 0 ? elements[iElem] : skippedElements[-1 - iElem];
+  }
 
   /**
-   * @brief Initialize a PLYData by reading from a file. Throws if any failures occur.
+   * @brief Which properties of an element in the file being read should be loaded.
    *
-   * @param filename The file to read from.
-   * @param verbose If true, print useful info about the file to stdout
+   * @param iFile Position of the element in the file.
+   *
+   * @return For each property, true if it should be loaded.
    */
-  PLYData(const std::string& filename, bool verbose = false) {
+  std::vector<bool> propertiesToLoad(size_t iFile) {
+    Element& elem = fileElement(iFile);
+    std::vector<bool> load(elem.properties.size(), fileOrder[iFile] >= 0);
+    if (fileOrder[iFile] < 0 || readOptions.projection.empty()) return load;
+    const std::vector<std::string>& names = readOptions.projection[elem.name];
+    if (names.empty()) return load;
+    for (size_t iP = 0; iP < elem.properties.size(); iP++) {
+      load[iP] = std::find(names.begin(), names.end(), elem.properties[iP]->name) != names.end();
+    }
+    return load;
+  }
+
+  /**
+   * @brief Read the header for a file
+   *
+   * @param inStream
+   * @param verbose
+   */
+  void parseHeader(std::istream& inStream, bool verbose) {
 
     using std::cout;
     using std::endl;
     using std::string;
     using std::vector;
 
-    if (verbose) cout << "PLY parser: Reading ply file: " << filename << endl;
+    // First two lines are predetermined
+    { // First line is magic constant
+      string plyLine;
+      std::getline(inStream, plyLine);
+      if (trimSpaces(plyLine) != "ply") {
+        throw std::runtime_error("PLY parser: File does not appear to be ply file. First line should be 'ply'");
+      }
+    }
 
-    // Open a file in binary always, in case it turns out to have binary data.
-    std::ifstream inStream(filename, std::ios::binary);
-    if (inStream.fail()) {
-      throw std::runtime_error("PLY parser: Could not open file " + filename);
+    { // second line is version
+      string styleLine;
+      std::getline(inStream, styleLine);
+      vector<string> tokens = tokenSplit(styleLine);
+      if (tokens.size() != 3) throw std::runtime_error("PLY parser: bad format line");
+      std::string formatStr = tokens[0];
+      std::string typeStr = tokens[1];
+      std::string versionStr = tokens[2];
+
+      // "format"
+      if (formatStr != "format") throw std::runtime_error("PLY parser: bad format line");
+
+      // ascii/binary
+      if (typeStr == "ascii") {
+        inputDataFormat = DataFormat::ASCII;
+        if (verbose) cout << "  - Type: ascii" << endl;
+      } else if (typeStr == "binary_little_endian") {
+        inputDataFormat = DataFormat::Binary;
+        if (verbose) cout << "  - Type: binary" << endl;
+      } else if (typeStr == "binary_big_endian") {
+        inputDataFormat = DataFormat::BinaryBigEndian;
+        if (verbose) cout << "  - Type: binary big endian" << endl;
+      } else {
+        throw std::runtime_error("PLY parser: bad format line");
+      }
+
+      // version
+      if (versionStr != "1.0") {
+        throw std::runtime_error("PLY parser: encountered file with version != 1.0. Don't know how to parse that");
+      }
+      if (verbose) cout << "  - Version: " << versionStr << endl;
     }
 
-    parsePLY(inStream, verbose);
+    // Consume header line by line
+    while (inStream.good()) {
+      string line;
+      std::getline(inStream, line);
 
-    if (verbose) {
-      cout << "  - Finished parsing file." << endl;
+      // Parse a comment
+      if (startsWith(line, "comment")) {
+        // Skip the comment if it's empty
+        if (line.length() <= 8) continue;
+        string comment = line.substr(8);
+        if (verbose) cout << "  - Comment: " << comment << endl;
+        comments.push_back(comment);
+        continue;
+      }
+
+      // Parse an obj_info comment
+      if (startsWith(line, "obj_info")) {
+        // Skip the comment if it's empty
+        if (line.length() <= 9) continue;
+        string infoComment = line.substr(9);
+        if (verbose) cout << "  - obj_info: " << infoComment << endl;
+        objInfoComments.push_back(infoComment);
+        continue;
+      }
+
+      // Parse an element
+      else if (startsWith(line, "element")) {
+        vector<string> tokens = tokenSplit(line);
+        if (tokens.size() != 3) throw std::runtime_error("PLY parser: Invalid element line");
+        string name = tokens[1];
+        size_t count;
+        std::istringstream iss(tokens[2]);
+        iss >> count;
+        elements.emplace_back(name, count);
+        if (verbose) cout << "  - Found element: " << name << " (count = " << count << ")" << endl;
+        continue;
+      }
+
+      // Parse a property list
+      else if (startsWith(line, "property list")) {
+        vector<string> tokens = tokenSplit(line);
+        if (tokens.size() != 5) throw std::runtime_error("PLY parser: Invalid property list line");
+        if (elements.size() == 0) throw std::runtime_error("PLY parser: Found property list without previous element");
+        string countType = tokens[2];
+        string type = tokens[3];
+        string name = tokens[4];
+        elements.back().properties.push_back(createPropertyWithType(name, type, true, countType));
+        if (verbose)
+          cout << "    - Found list property: " << name << " (count type = " << countType << ", data type = " << type
+               << ")" << endl;
+        continue;
+      }
+
+      // Parse a property
+      else if (startsWith(line, "property")) {
+        vector<string> tokens = tokenSplit(line);
+        if (tokens.size() != 3) throw std::runtime_error("PLY parser: Invalid property line");
+        if (elements.size() == 0) throw std::runtime_error("PLY parser: Found property without previous element");
+        string type = tokens[1];
+        string name = tokens[2];
+        elements.back().properties.push_back(createPropertyWithType(name, type, false, ""));
+        if (verbose) cout << "    - Found property: " << name << " (type = " << type << ")" << endl;
+        continue;
+      }
+
+      // Parse end of header
+      else if (startsWith(line, "end_header")) {
+        break;
+      }
+
+      // Error!
+      else {
+        throw std::runtime_error("Unrecognized header line: " + line);
+      }
     }
   }
 
   /**
-   * @brief Initialize a PLYData by reading from a stringstream. Throws if any failures occur.
+   * @brief Find the memory bound to each property of an element in the file being read (see ReadOptions::bind()).
+   * Throws if a binding cannot be used.
    *
-   * @param inStream The stringstream to read from.
-   * @param verbose If true, print useful info about the file to stdout
+   * @param iFile Position of the element in the file.
+   * @param load For each property, is it loaded?
+   *
+   * @return For each property, the memory bound to it, or null if there is none or it is not loaded.
    */
-  PLYData(std::istream& inStream, bool verbose = false) {
+  std::vector<const PropertyBinding*> findBindings(size_t iFile, const std::vector<bool>& load) {
+    Element& elem = fileElement(iFile);
+    std::vector<const PropertyBinding*> bound(elem.properties.size(), nullptr);
+    for (const PropertyBinding& binding : readOptions.bindings) {
+      if (binding.element != elem.name) continue;
+      for (size_t iP = 0; iP < elem.properties.size(); iP++) {
+        if (!load[iP] || elem.properties[iP]->name != binding.property) continue;
+        if (elem.properties[iP]->fixedByteWidth() == 0) {
+          throw std::runtime_error("PLY parser: cannot bind list property " + binding.property + " of element " +
+                                   elem.name);
+        }
+        if (binding.capacity < elem.count) {
+          throw std::runtime_error("PLY parser: memory bound to property " + binding.property + " has room for " +
+                                   std::to_string(binding.capacity) + " records, but element " + elem.name + " has " +
+                                   std::to_string(elem.count));
+        }
+        bound[iP] = &binding;
+      }
+    }
+    return bound;
+  }
 
-    using std::cout;
-    using std::endl;
+  /**
+   * @brief Can a property be decoded straight in to the memory bound to it?
+   *
+   * @param binding The memory bound to the property, or null.
+   * @param prop The property.
+   *
+   * @return True if the data is binary and the types match exactly.
+   */
+  bool bindsInPlace(const PropertyBinding* binding, Property& prop) {
+    return binding != nullptr && inputDataFormat != DataFormat::ASCII && binding->typeName == prop.propertyTypeName();
+  }
+
+  /**
+   * @brief Read the data for a single element, in whatever format the file uses. Properties which are not being loaded
+   * are skipped over, and then removed from the element, as are those which are loaded in to bound memory.
+   *
+   * @param source
+   * @param iFile Position of the element in the file.
+   */
+  void parseElement(BufferedReader& source, size_t iFile) {
+
+    Element& elem = fileElement(iFile);
+    std::vector<bool> load = propertiesToLoad(iFile);
+    std::vector<const PropertyBinding*> bound = findBindings(iFile, load);
 
-    if (verbose) cout << "PLY parser: Reading ply file from stream" << endl;
+    // Skip elements entirely if nothing is loaded from them
+    if (fileOrder[iFile] < 0 || (!load.empty() && std::find(load.begin(), load.end(), true) == load.end())) {
+      skipElement(source, elem);
+    } else if (inputDataFormat == DataFormat::ASCII) {
+      std::vector<Property*> destinations(elem.properties.size(), nullptr);
+      for (size_t iP = 0; iP < elem.properties.size(); iP++) {
+        if (!load[iP]) continue;
+        elem.properties[iP]->reserve(elem.count);
+        destinations[iP] = elem.properties[iP].get();
+      }
+      parseASCIIRecords(source, elem, destinations, elem.count);
+    } else {
+      parseBinaryElement(source, elem, load, bound, inputDataFormat == DataFormat::BinaryBigEndian);
+    }
 
-    parsePLY(inStream, verbose);
+    // Copy any bound properties which could not be decoded in place
+    for (size_t iP = 0; iP < bound.size(); iP++) {
+      if (bound[iP] != nullptr && !bindsInPlace(bound[iP], *elem.properties[iP])) bound[iP]->copyFrom(elem);
+    }
 
-    if (verbose) {
-      cout << "  - Finished parsing stream." << endl;
+    // Remove the properties that were not loaded, or were loaded in to bound memory
+    for (size_t iP = load.size(); iP > 0; iP--) {
+      if (!load[iP - 1] || bound[iP - 1] != nullptr) elem.properties.erase(elem.properties.begin() + (iP - 1));
     }
   }
 
   /**
-   * @brief Perform sanity checks on the file, throwing if any fail.
+   * @brief Read records of an element, in ASCII, appending the values to properties. Large elements are parsed in
+   * parallel if there are several threads (see ReadOptions::threads).
+   *
+   * @param source
+   * @param elem The element being read.
+   * @param destinations For each property in the element, the property to append it to, or null if it is skipped.
+   * @param nRecords Number of records to read.
    */
-  void validate() {
+  void parseASCIIRecords(BufferedReader& source, Element& elem, const std::vector<Property*>& destinations,
+                         size_t nRecords) {
 
-    for (size_t iE = 0; iE < elements.size(); iE++) {
-      for (char c : elements[iE].name) {
-        if (std::isspace(c)) {
-          throw std::runtime_error("Ply validate: illegal whitespace in element name " + elements[iE].name);
-        }
-      }
-      for (size_t jE = iE + 1; jE < elements.size(); jE++) {
-        if (elements[iE].name == elements[jE].name) {
-          throw std::runtime_error("Ply validate: duplcate element name " + elements[iE].name);
-        }
-      }
+    const size_t minRecordsPerThread = 1 << 14;
+    if (readOptions.threads > 1 && nRecords >= 2 * minRecordsPerThread && !elem.properties.empty()) {
+      parseASCIIRecordsParallel(source, elem, destinations, nRecords, minRecordsPerThread);
+      return;
     }
 
-    // Do a quick validation sanity check
-    for (Element& e : elements) {
-      e.validate();
+    for (size_t iEntry = 0; iEntry < nRecords; iEntry++) {
+      const char* lineBegin;
+      const char* lineEnd;
+      readASCIILine(source, elem, lineBegin, lineEnd);
+      parseASCIILine(elem, destinations, lineBegin, lineEnd);
     }
   }
 
   /**
-   * @brief Write this data to a .ply file.
+   * @brief Parse the line of one record of an element, in ASCII, appending the values to properties.
    *
-   * @param filename The file to write to.
-   * @param format The format to use (binary or ascii?)
+   * @param elem The element being read.
+   * @param destinations For each property in the element, the property to append it to, or null if it is skipped.
+   * @param lineBegin Start of the line.
+   * @param lineEnd End of the line.
    */
-  void write(const std::string& filename, DataFormat format = DataFormat::ASCII) {
-    outputDataFormat = format;
-
-    validate();
-
-    // Open stream for writing
-    std::ofstream outStream(filename, std::ios::out | std::ios::binary);
-    if (!outStream.good()) {
-      throw std::runtime_error("Ply writer: Could not open output file " + filename + " for writing");
+  void parseASCIILine(Element& elem, const std::vector<Property*>& destinations, const char* lineBegin,
+                      const char* lineEnd) {
+    ASCIITokenizer tokens(lineBegin, lineEnd);
+    for (size_t iP = 0; iP < elem.properties.size(); iP++) {
+      const std::string& name = elem.properties[iP]->name;
+      if (destinations[iP] != nullptr) {
+        destinations[iP]->parseNext(tokens);
+      } else if (elem.properties[iP]->fixedByteWidth() > 0) {
+        tokens.skip(name);
+      } else {
+        // Skip a list, without parsing anything but its count
+        size_t count = tokens.next<size_t>(name);
+        if (count > tokens.maxTokensLeft()) {
+          throw std::runtime_error("PLY parser: list property " + name + " has fewer values than its count");
+        }
+        for (size_t i = 0; i < count; i++) {
+          tokens.skip(name);
+        }
+      }
     }
-
-    writePLY(outStream);
   }
 
   /**
-   * @brief Write this data to an output stream
+   * @brief Read records of an element, in ASCII, in parallel. The lines of a block of records are found, then split in
+   * to chunks which are each parsed by a thread in to their own properties, and finally copied in to place, with the
+   * list starts of each chunk offset by the values of the chunks before it.
    *
-   * @param outStream The output stream to write to.
-   * @param format The format to use (binary or ascii?)
+   * @param source
+   * @param elem The element being read.
+   * @param destinations For each property in the element, the property to append it to, or null if it is skipped.
+   * @param nRecords Number of records to read.
+   * @param minRecordsPerThread Smallest number of records worth giving a thread.
    */
-  void write(std::ostream& outStream, DataFormat format = DataFormat::ASCII) {
-    outputDataFormat = format;
+  void parseASCIIRecordsParallel(BufferedReader& source, Element& elem, const std::vector<Property*>& destinations,
+                                 size_t nRecords, size_t minRecordsPerThread) {
+
+    size_t nThreads = readOptions.threads;
+    size_t nProps = destinations.size();
+
+    // Each chunk of a block is parsed in to empty copies of the destinations, which are reused for every block, and
+    // for later calls on the same element
+    std::vector<bool> loaded(nProps);
+    for (size_t iP = 0; iP < nProps; iP++) loaded[iP] = destinations[iP] != nullptr;
+    ASCIIStaging& state = asciiStaging;
+    if (state.elem != &elem || state.loaded != loaded || state.properties.size() != nThreads) {
+      state.elem = &elem;
+      state.loaded = loaded;
+      state.properties.clear();
+      state.properties.resize(nThreads);
+      state.destinations.assign(nThreads, std::vector<Property*>(nProps, nullptr));
+      for (size_t c = 0; c < nThreads; c++) {
+        for (size_t iP = 0; iP < nProps; iP++) {
+          if (destinations[iP] == nullptr) continue;
+          state.properties[c].push_back(destinations[iP]->emptyCopy());
+          state.destinations[c][iP] = state.properties[c].back().get();
+        }
+      }
+    }
+    std::vector<std::vector<std::unique_ptr<Property>>>& staging = state.properties;
+    std::vector<std::vector<Property*>>& chunkDestinations = state.destinations;
+    std::vector<const char*>& lineBegins = state.lineBegins;
+    std::vector<const char*>& lineEnds = state.lineEnds;
+    std::vector<size_t>& chunkValues = state.chunkValues;
+    std::vector<size_t>& firstEntry = state.firstEntry;
+
+    size_t iRecord = 0;
+    while (iRecord < nRecords) {
+      size_t usedBytes =
+          findASCIILines(source, nRecords - iRecord, nThreads * readOptions.bufferBytes, lineBegins, lineEnds);
+      size_t nLines = lineBegins.size();
+      if (nLines == 0) {
+        throw std::runtime_error("PLY parser: unexpected end of file while reading element " + elem.name);
+      }
+      size_t nChunks = std::min(nThreads, nLines / minRecordsPerThread + 1);
+      auto chunkStart = [&](size_t c) { return nLines * c / nChunks; };
+
+      // Parse each chunk
+      parallelFor(nChunks, nChunks, [&](size_t cStart, size_t cEnd) {
+        for (size_t c = cStart; c < cEnd; c++) {
+          for (std::unique_ptr<Property>& prop : staging[c]) {
+            prop->resize(0);
+            prop->resizeValues(0);
+            prop->reserve(chunkStart(c + 1) - chunkStart(c));
+          }
+          for (size_t iLine = chunkStart(c); iLine < chunkStart(c + 1); iLine++) {
+            parseASCIILine(elem, chunkDestinations[c], lineBegins[iLine], lineEnds[iLine]);
+          }
+        }
+      });
+
+      // Make room in the destinations, and find where each chunk's list values go
+      chunkValues.assign(nChunks * nProps, 0);
+      firstEntry.assign(nProps, 0);
+      for (size_t iP = 0; iP < nProps; iP++) {
+        Property* dst = destinations[iP];
+        if (dst == nullptr) continue;
+        firstEntry[iP] = dst->size();
+        dst->resize(firstEntry[iP] + nLines);
+        if (dst->listStartStorage() == nullptr) continue;
+        size_t nValues = dst->listStartStorage()[firstEntry[iP]];
+        for (size_t c = 0; c < nChunks; c++) {
+          chunkValues[c * nProps + iP] = nValues;
+          nValues += chunkDestinations[c][iP]->listStartStorage()[chunkStart(c + 1) - chunkStart(c)];
+        }
+        dst->resizeValues(nValues);
+      }
 
-    validate();
+      // Copy each chunk in to place
+      parallelFor(nChunks, nChunks, [&](size_t cStart, size_t cEnd) {
+        for (size_t c = cStart; c < cEnd; c++) {
+          size_t nChunkLines = chunkStart(c + 1) - chunkStart(c);
+          for (size_t iP = 0; iP < nProps; iP++) {
+            Property* dst = destinations[iP];
+            if (dst == nullptr) continue;
+            Property* src = chunkDestinations[c][iP];
+            size_t width = dst->valueByteWidth();
+            size_t iEntry = firstEntry[iP] + chunkStart(c);
+            if (dst->listStartStorage() == nullptr) {
+              if (nChunkLines > 0) {
+                std::memcpy(dst->valueStorage() + iEntry * width, src->valueStorage(), nChunkLines * width);
+              }
+              continue;
+            }
+            size_t iValue = chunkValues[c * nProps + iP];
+            const size_t* srcStarts = src->listStartStorage();
+            size_t* dstStarts = dst->listStartStorage();
+            if (srcStarts[nChunkLines] > 0) {
+              std::memcpy(dst->valueStorage() + iValue * width, src->valueStorage(), srcStarts[nChunkLines] * width);
+            }
+            for (size_t i = 1; i <= nChunkLines; i++) {
+              dstStarts[iEntry + i] = iValue + srcStarts[i];
+            }
+          }
+        }
+      });
 
-    writePLY(outStream);
+      source.consume(usedBytes);
+      iRecord += nLines;
+    }
   }
 
   /**
-   * @brief Get an element type by name ("vertices")
+   * @brief Find the lines of the next records of an element, in ASCII, within a block of the source's buffer. Blank
+   * lines are skipped. Nothing is consumed from the source, so the lines stay valid until it is read again.
    *
-   * @param target The name of the element type to get
+   * @param source
+   * @param maxLines Largest number of lines to find.
+   * @param blockBytes Approximate number of bytes to search. More are read if not even one line is complete.
+   * @param lineBegins Output, the start of each line.
+   * @param lineEnds Output, the end of each line, not including its newline.
    *
-   * @return A reference to the element type.
+   * @return The number of bytes up to the end of the last line found, including its newline. None are found only if
+   * the file ends first.
    */
-  Element& getElement(const std::string& target) {
-    for (Element& e : elements) {
-      if (e.name == target) return e;
+  size_t findASCIILines(BufferedReader& source, size_t maxLines, size_t blockBytes,
+                        std::vector<const char*>& lineBegins, std::vector<const char*>& lineEnds) {
+    size_t wantBytes = blockBytes;
+    while (true) {
+      bool more = source.fill(wantBytes); // false if the whole rest of the file is buffered
+      lineBegins.clear();
+      lineEnds.clear();
+      const char* pos = source.data();
+      const char* end = pos + source.size();
+      while (lineBegins.size() < maxLines && pos < end) {
+        const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        if (newline == nullptr) {
+          if (more) break; // the rest of the line is not buffered yet
+          newline = end;   // the last line of the file
+        }
+        if (!std::all_of(pos, newline, isTokenSpace)) {
+          lineBegins.push_back(pos);
+          lineEnds.push_back(newline);
+        }
+        pos = newline == end ? end : newline + 1;
+      }
+      size_t usedBytes = pos - source.data();
+      if (!lineBegins.empty() || !more) return usedBytes;
+
+      if (usedBytes > 0) {
+        source.consume(usedBytes); // only blank lines so far
+      } else {
+        wantBytes = source.size() + blockBytes; // a line longer than the block
+      }
     }
-    throw std::runtime_error("PLY parser: no element with name: " + target);
   }
 
-
   /**
-   * @brief Check if an element type exists
-   *
-   * @param target The name to check for.
+   * @brief Read the line holding the next entry of an element, in ASCII.
    *
-   * @return True if exists.
+   * @param source
+   * @param elem The element being read.
+   * @param lineBegin Output, the start of the line, which stays valid until the source is read again.
+   * @param lineEnd Output, the end of the line.
    */
-  bool hasElement(const std::string& target) {
-    for (Element& e : elements) {
-      if (e.name == target) return true;
+  void readASCIILine(BufferedReader& source, Element& elem, const char*& lineBegin, const char*& lineEnd) {
+    bool found = source.readLine(lineBegin, lineEnd);
+
+    // Some .ply files seem to include empty lines before the start of property data (though this is not specified
+    // in the format description). We attempt to recover and parse such files by skipping any empty lines.
+    if (!elem.properties.empty()) { // if the element has no properties, the line _should_ be blank, presumably
+      auto isBlank = [&]() { return std::all_of(lineBegin, lineEnd, isTokenSpace); };
+      while (found && isBlank()) { // skip lines until we hit something nonempty
+        found = source.readLine(lineBegin, lineEnd);
+      }
+      if (!found) {
+        throw std::runtime_error("PLY parser: unexpected end of file while reading element " + elem.name);
+      }
     }
-    return false;
   }
 
-
   /**
-   * @brief A list of the names of all elements
+   * @brief Read the data for a single element, in binary. Rather than reading value-by-value, the records are read in
+   * large blocks which are then decoded by the element's compiled DecodePlan.
    *
-   * @return Element names
+   * @param source
+   * @param elem The element to read.
+   * @param load For each property, should it be loaded or skipped?
+   * @param bound For each property, the memory bound to it, or null (see findBindings()).
+   * @param bigEndian Is the data stored big endian?
    */
-  std::vector<std::string> getElementNames() {
-    std::vector<std::string> names;
-    for (Element& e : elements) {
-      names.push_back(e.name);
+  void parseBinaryElement(BufferedReader& source, Element& elem, const std::vector<bool>& load,
+                          const std::vector<const PropertyBinding*>& bound, bool bigEndian) {
+
+    std::shared_ptr<const DecodePlan> plan = getDecodePlan(elem, load, bigEndian);
+    std::vector<Property*> destinations(elem.properties.size(), nullptr);
+    for (size_t iP = 0; iP < elem.properties.size(); iP++) {
+      if (!load[iP] || bindsInPlace(bound[iP], *elem.properties[iP])) continue;
+      elem.properties[iP]->resize(elem.count);
+      destinations[iP] = elem.properties[iP].get();
     }
-    return names;
-  }
 
+    size_t nThreads = readOptions.threads;
+    RecordBlockReader reader(source, elem, *plan, nThreads * readOptions.bufferBytes,
+                             plan->stride > 0 ? 1 : nThreads);
+    BlockDecoder decoder(*plan, destinations, nThreads);
+    for (size_t iP = 0; iP < elem.properties.size(); iP++) {
+      if (bindsInPlace(bound[iP], *elem.properties[iP])) {
+        decoder.bindMemory(iP, bound[iP]->values, bound[iP]->strideBytes);
+      }
+    }
+    size_t iRecord = 0;
+    while (reader.next()) {
+      decoder.decode(reader, iRecord);
+      iRecord += reader.size();
+    }
+  }
 
   /**
-   * @brief Add a new element type to the object
+   * @brief Get the compiled decode plan for an element, from the cache in the read options if there is one.
    *
-   * @param name The name of the new element type ("vertices").
-   * @param count The number of elements of this type.
+   * @param elem The element.
+   * @param load For each property, should it be decoded or skipped over?
+   * @param bigEndian Is the data stored big endian?
+   *
+   * @return The plan.
    */
-  void addElement(const std::string& name, size_t count) { elements.emplace_back(name, count); }
-
-  // === Common-case helpers
-
+  std::shared_ptr<const DecodePlan> getDecodePlan(Element& elem, const std::vector<bool>& load, bool bigEndian) {
+    if (readOptions.planCache) {
+      return readOptions.planCache->get(elem, load, bigEndian);
+    }
+    return std::make_shared<DecodePlan>(elem, load, bigEndian);
+  }
 
   /**
-   * @brief Common-case helper get mesh vertex positions
+   * @brief Read past the data for a single element without decoding it.
    *
-   * @param vertexElementName The element name to use (default: "vertex")
-   *
-   * @return A vector of vertex positions.
+   * @param source
+   * @param elem The element to skip.
    */
-  std::vector<std::array<double, 3>> getVertexPositions(const std::string& vertexElementName = "vertex") {
-
-    std::vector<double> xPos = getElement(vertexElementName).getProperty<double>("x");
-    std::vector<double> yPos = getElement(vertexElementName).getProperty<double>("y");
-    std::vector<double> zPos = getElement(vertexElementName).getProperty<double>("z");
-
-    std::vector<std::array<double, 3>> result(xPos.size());
-    for (size_t i = 0; i < result.size(); i++) {
-      result[i][0] = xPos[i];
-      result[i][1] = yPos[i];
-      result[i][2] = zPos[i];
+  void skipElement(BufferedReader& source, Element& elem) {
+    if (inputDataFormat == DataFormat::ASCII) {
+      const char* lineBegin;
+      const char* lineEnd;
+      for (size_t iEntry = 0; iEntry < elem.count; iEntry++) {
+        readASCIILine(source, elem, lineBegin, lineEnd);
+      }
+    } else {
+      std::vector<bool> load(elem.properties.size(), false);
+      std::shared_ptr<const DecodePlan> plan =
+          getDecodePlan(elem, load, inputDataFormat == DataFormat::BinaryBigEndian);
+      RecordBlockReader reader(source, elem, *plan, readOptions.bufferBytes);
+      while (reader.next()) {
+      }
     }
-
-    return result;
   }
 
   /**
-   * @brief Common-case helper get mesh vertex colors
-   *
-   * @param vertexElementName The element name to use (default: "vertex")
+   * @brief (lazy loading) Decode the data for an element which has not been loaded yet.
    *
-   * @return A vector of vertex colors (unsigned chars [0,255]).
+   * @param iFile Position of the element in the file.
    */
-  std::vector<std::array<unsigned char, 3>> getVertexColors(const std::string& vertexElementName = "vertex") {
+  void loadElement(size_t iFile) {
 
-    std::vector<unsigned char> r = getElement(vertexElementName).getProperty<unsigned char>("red");
-    std::vector<unsigned char> g = getElement(vertexElementName).getProperty<unsigned char>("green");
-    std::vector<unsigned char> b = getElement(vertexElementName).getProperty<unsigned char>("blue");
+    if (inputDataFormat != DataFormat::ASCII && !isLittleEndian()) {
+      throw std::runtime_error("binary reading assumes little endian system");
+    }
 
-    std::vector<std::array<unsigned char, 3>> result(r.size());
-    for (size_t i = 0; i < result.size(); i++) {
-      result[i][0] = r[i];
-      result[i][1] = g[i];
-      result[i][2] = b[i];
+    // Find where the element starts, walking over earlier elements whose sizes are not known yet
+    while (elementStarts.size() <= iFile) {
+      size_t iPrev = elementStarts.size() - 1;
+      Element& prev = fileElement(iPrev);
+      size_t stride = prev.fixedStride();
+      if (inputDataFormat != DataFormat::ASCII && stride > 0) {
+        elementStarts.push_back(elementStarts[iPrev] + static_cast<std::streamoff>(prev.count * stride));
+      } else {
+        lazyStream->clear(); // as below, an earlier failed load may have left the stream at its end
+        lazyStream->seekg(elementStarts[iPrev]);
+        BufferedReader source(*lazyStream, readOptions.bufferBytes, readOptions.prefetch);
+        skipElement(source, prev);
+        source.release();
+        elementStarts.push_back(lazyStream->tellg());
+      }
     }
 
-    return result;
+    lazyStream->clear(); // an earlier failed load may have left the stream at its end
+    lazyStream->seekg(elementStarts[iFile]);
+    BufferedReader source(*lazyStream, readOptions.bufferBytes, readOptions.prefetch);
+    try {
+      parseElement(source, iFile);
+    } catch (const std::runtime_error&) {
+      // Throw away anything decoded before the failure, so that a later attempt starts from empty properties
+      for (std::unique_ptr<Property>& prop : fileElement(iFile).properties) {
+        prop = prop->emptyCopy();
+      }
+      throw;
+    }
+    source.release();
+    if (elementStarts.size() == iFile + 1) {
+      elementStarts.push_back(lazyStream->tellg());
+    }
+    elementLoaded[iFile] = true;
+
+    loadElementsIfDone();
   }
 
   /**
-   * @brief Common-case helper to get face indices for a mesh. If not template type is given, size_t is used. Naively
-   * converts to requested signedness, which may lead to unexpected values if an unsigned type is used and file contains
-   * negative values.
-   *
-   * @return The indices into the vertex elements for each face. Usually 0-based, though there are no formal rules.
+   * @brief (lazy loading) Close the file once every element has been loaded.
    */
-  template <typename T = size_t>
-  std::vector<std::vector<T>> getFaceIndices() {
+  void loadElementsIfDone() {
+    if (std::find(elementLoaded.begin(), elementLoaded.end(), false) == elementLoaded.end()) {
+      finishReading();
+    }
+  }
 
-    for (const std::string& f : std::vector<std::string>{"face"}) {
-      for (const std::string& p : std::vector<std::string>{"vertex_indices", "vertex_index"}) {
-        try {
-          return getElement(f).getListPropertyAnySign<T>(p);
-        } catch (const std::runtime_error&) {
-          // that's fine
-        }
-      }
+  /**
+   * @brief (lazy loading) Make sure every element has been loaded.
+   */
+  void loadAllElements() {
+    for (size_t iFile = 0; iFile < elementLoaded.size(); iFile++) {
+      if (!elementLoaded[iFile]) loadElement(iFile);
     }
-    throw std::runtime_error("PLY parser: could not find face vertex indices attribute under any common name.");
   }
 
+  // === Writing ===
+
 
   /**
-   * @brief Common-case helper set mesh vertex positons. Creates vertex element, if necessary.
+   * @brief write a PLY file to an output stream
    *
-   * @param vertexPositions A vector of vertex positions
+   * @param outStream
+   * @param options
+   * @param afterWrite If given, called after each block is written to the stream.
    */
-  void addVertexPositions(std::vector<std::array<double, 3>>& vertexPositions) {
+  void writePLY(std::ostream& outStream, const WriteOptions& options, std::function<void()> afterWrite = nullptr) {
 
-    std::string vertexName = "vertex";
-    size_t N = vertexPositions.size();
+    writeHeader(outStream);
 
-    // Create the element
-    if (!hasElement(vertexName)) {
-      addElement(vertexName, N);
-    }
+    // Data is packed or formatted in to a large buffer, which is written out a block at a time
+    BufferedWriter buffer(outStream, options.bufferBytes);
+    buffer.setWriteHook(std::move(afterWrite));
+    ASCIIWriter asciiOut(buffer, options.precision);
 
-    // De-interleave
-    std::vector<double> xPos(N);
-    std::vector<double> yPos(N);
-    std::vector<double> zPos(N);
-    for (size_t i = 0; i < vertexPositions.size(); i++) {
-      xPos[i] = vertexPositions[i][0];
-      yPos[i] = vertexPositions[i][1];
-      zPos[i] = vertexPositions[i][2];
+    // Write all elements
+    for (Element& e : elements) {
+      writeElementData(e, buffer, asciiOut, options);
     }
-
-    // Store
-    getElement(vertexName).addProperty<double>("x", xPos);
-    getElement(vertexName).addProperty<double>("y", yPos);
-    getElement(vertexName).addProperty<double>("z", zPos);
+    buffer.flush();
   }
 
   /**
-   * @brief Common-case helper set mesh vertex colors. Creates a vertex element, if necessary.
+   * @brief Write all of the records of an element, in the output format.
    *
-   * @param colors A vector of vertex colors (unsigned chars [0,255]).
+   * @param e The element to write.
+   * @param buffer Where the data goes.
+   * @param asciiOut A writer formatting text in to buffer, for ASCII output.
+   * @param options Options controlling how the data is written.
    */
-  void addVertexColors(std::vector<std::array<unsigned char, 3>>& colors) {
-
-    std::string vertexName = "vertex";
-    size_t N = colors.size();
-
-    // Create the element
-    if (!hasElement(vertexName)) {
-      addElement(vertexName, N);
-    }
-
-    // De-interleave
-    std::vector<unsigned char> r(N);
-    std::vector<unsigned char> g(N);
-    std::vector<unsigned char> b(N);
-    for (size_t i = 0; i < colors.size(); i++) {
-      r[i] = colors[i][0];
-      g[i] = colors[i][1];
-      b[i] = colors[i][2];
+  void writeElementData(Element& e, BufferedWriter& buffer, ASCIIWriter& asciiOut, const WriteOptions& options) {
+    if (outputDataFormat == DataFormat::Binary) {
+      if (!isLittleEndian()) {
+        throw std::runtime_error("binary writing assumes little endian system");
+      }
+      e.writeDataBinary(buffer, false, 0, e.count);
+    } else if (outputDataFormat == DataFormat::BinaryBigEndian) {
+      if (!isLittleEndian()) {
+        throw std::runtime_error("binary writing assumes little endian system");
+      }
+      e.writeDataBinary(buffer, true, 0, e.count);
+    } else if (outputDataFormat == DataFormat::ASCII) {
+      size_t nThreads = resolveThreadCount(options.threads);
+      const size_t minRecordsPerThread = 1 << 14;
+      if (nThreads > 1 && e.count >= 2 * minRecordsPerThread) {
+        writeElementASCIIParallel(e, buffer, options.precision, nThreads, minRecordsPerThread);
+      } else {
+        e.writeDataASCII(asciiOut);
+      }
     }
-
-    // Store
-    getElement(vertexName).addProperty<unsigned char>("red", r);
-    getElement(vertexName).addProperty<unsigned char>("green", g);
-    getElement(vertexName).addProperty<unsigned char>("blue", b);
   }
 
   /**
-   * @brief Common-case helper set mesh vertex colors. Creates a vertex element, if necessary.
+   * @brief Write a binary file in parallel. The size of every part of the file is known from the counts and list
+   * lengths, so the file is created at its full size and mapped in to memory, and then each element is split in to one
+   * range of records per thread, which is packed straight in to its place in the file.
    *
-   * @param colors A vector of vertex colors as floating point [0,1] values. Internally converted to [0,255] chars.
+   * @param filename The file to write to.
+   * @param nThreads Number of threads to use.
+   * @param pageCache How to treat the page cache (see WriteOptions::pageCache).
    */
-  void addVertexColors(std::vector<std::array<double, 3>>& colors) {
+  void writeBinaryParallel(const std::string& filename, size_t nThreads, PageCacheMode pageCache) {
+    if (!isLittleEndian()) {
+      throw std::runtime_error("binary writing assumes little endian system");
+    }
+    bool bigEndian = outputDataFormat == DataFormat::BinaryBigEndian;
 
-    std::string vertexName = "vertex";
-    size_t N = colors.size();
+    std::ostringstream headerStream;
+    writeHeader(headerStream);
+    std::string headerText = headerStream.str();
 
-    // Create the element
-    if (!hasElement(vertexName)) {
-      addElement(vertexName, N);
+    // Split each element in to ranges, and find where each one goes
+    const size_t minRecordsPerThread = 1 << 14;
+    std::vector<size_t> nChunks(elements.size());
+    std::vector<std::vector<size_t>> chunkOffsets(elements.size());
+    size_t fileBytes = headerText.size();
+    for (size_t iE = 0; iE < elements.size(); iE++) {
+      Element& e = elements[iE];
+      nChunks[iE] = std::min(nThreads, e.count / minRecordsPerThread + 1);
+      for (size_t c = 0; c <= nChunks[iE]; c++) {
+        chunkOffsets[iE].push_back(fileBytes + e.binaryDataBytes(0, e.count * c / nChunks[iE]));
+      }
+      fileBytes = chunkOffsets[iE].back();
     }
 
-    auto toChar = [](double v) {
-      if (v < 0.0) v = 0.0;
-      if (v > 1.0) v = 1.0;
-      return static_cast<unsigned char>(v * 255.);
-    };
+    MappedOutputFile file(filename, fileBytes);
+    std::memcpy(file.data(), headerText.data(), headerText.size());
+    for (size_t iE = 0; iE < elements.size(); iE++) {
+      Element& e = elements[iE];
+      const std::vector<size_t>& offsets = chunkOffsets[iE];
+      parallelFor(nChunks[iE], nChunks[iE], [&](size_t cStart, size_t cEnd) {
+        for (size_t c = cStart; c < cEnd; c++) {
+          BufferedWriter out(file.data() + offsets[c], offsets[c + 1] - offsets[c]);
+          e.writeDataBinary(out, bigEndian, e.count * c / nChunks[iE], e.count * (c + 1) / nChunks[iE]);
+        }
+      });
+      if (pageCache == PageCacheMode::DropBehind) file.dropFromPageCache(iE == 0 ? 0 : offsets.front(), offsets.back());
+    }
+  }
 
-    // De-interleave
-    std::vector<unsigned char> r(N);
-    std::vector<unsigned char> g(N);
-    std::vector<unsigned char> b(N);
-    for (size_t i = 0; i < colors.size(); i++) {
-      r[i] = toChar(colors[i][0]);
-      g[i] = toChar(colors[i][1]);
-      b[i] = toChar(colors[i][2]);
+  /**
+   * @brief Write all of the records of an element in ASCII, formatting them in parallel. The records are taken a batch
+   * at a time, each batch is split in to one range per thread, the ranges are formatted in to their own memory, and
+   * then written out in order.
+   *
+   * @param e The element to write.
+   * @param buffer Where the text goes.
+   * @param precision See WriteOptions::precision.
+   * @param nThreads Number of threads to use.
+   * @param minRecordsPerThread Smallest number of records worth giving a thread.
+   */
+  void writeElementASCIIParallel(Element& e, BufferedWriter& buffer, int precision, size_t nThreads,
+                                 size_t minRecordsPerThread) {
+
+    // Each thread's text buffer is reused for every batch, so memory use is bounded by the batch size
+    const size_t recordsPerChunk = 4 * minRecordsPerThread;
+    std::vector<std::unique_ptr<BufferedWriter>> chunkText;
+    for (size_t c = 0; c < nThreads; c++) {
+      chunkText.emplace_back(new BufferedWriter(size_t(1) << 20));
     }
 
-    // Store
-    getElement(vertexName).addProperty<unsigned char>("red", r);
-    getElement(vertexName).addProperty<unsigned char>("green", g);
-    getElement(vertexName).addProperty<unsigned char>("blue", b);
+    for (size_t iBatch = 0; iBatch < e.count; iBatch += nThreads * recordsPerChunk) {
+      size_t nBatch = std::min(e.count - iBatch, nThreads * recordsPerChunk);
+      size_t nChunks = std::min(nThreads, nBatch / minRecordsPerThread + 1);
+      auto chunkStart = [&](size_t c) { return iBatch + nBatch * c / nChunks; };
+
+      parallelFor(nChunks, nChunks, [&](size_t cStart, size_t cEnd) {
+        for (size_t c = cStart; c < cEnd; c++) {
+          chunkText[c]->clear();
+          ASCIIWriter chunkOut(*chunkText[c], precision);
+          e.writeDataASCII(chunkOut, chunkStart(c), chunkStart(c + 1));
+        }
+      });
+
+      for (size_t c = 0; c < nChunks; c++) {
+        buffer.write(chunkText[c]->data(), chunkText[c]->size());
+      }
+    }
   }
 
 
   /**
-   * @brief Common-case helper to set face indices. Creates a face element if needed. The input type will be casted to a
-   * 32 bit integer of the same signedness.
+   * @brief Write out a header for a file
    *
-   * @param indices The indices into the vertex list around each face.
+   * @param outStream
+   * @param countOffsets If given, element counts are padded to a fixed width so that they can be overwritten later,
+   * and where each one is written is appended here, as an offset from the start of the header.
    */
-  template <typename T>
-  void addFaceIndices(std::vector<std::vector<T>>& indices) {
+  void writeHeader(std::ostream& outStream, std::vector<size_t>* countOffsets = nullptr) {
 
-    std::string faceName = "face";
-    size_t N = indices.size();
+    std::ostream::pos_type headerStart = outStream.tellp();
 
-    // Create the element
-    if (!hasElement(faceName)) {
-      addElement(faceName, N);
+    // Magic line
+    outStream << "ply\n";
+
+    // Type line
+    outStream << "format ";
+    if (outputDataFormat == DataFormat::Binary) {
+      outStream << "binary_little_endian ";
+    } else if (outputDataFormat == DataFormat::BinaryBigEndian) {
+      outStream << "binary_big_endian ";
+    } else if (outputDataFormat == DataFormat::ASCII) {
+      outStream << "ascii ";
     }
 
-    // Cast to 32 bit
-    typedef typename std::conditional<std::is_signed<T>::value, int32_t, uint32_t>::type IndType;
-    std::vector<std::vector<IndType>> intInds;
-    for (std::vector<T>& l : indices) {
-      std::vector<IndType> thisInds;
-      for (T& val : l) {
-        IndType valConverted = static_cast<IndType>(val);
-        if (valConverted != val) {
-          throw std::runtime_error("Index value " + std::to_string(val) +
-                                   " could not be converted to a .ply integer without loss of data. Note that .ply "
-                                   "only supports 32-bit ints.");
-        }
-        thisInds.push_back(valConverted);
+    // Version number
+    outStream << majorVersion << "." << minorVersion << "\n";
+
+    // Write comments
+    bool hasHapplyComment = false;
+    std::string happlyComment = "Written with hapPLY (https://github.com/nmwsharp/happly)";
+    for (const std::string& comment : comments) {
+      if (comment == happlyComment) hasHapplyComment = true;
+      outStream << "comment " << comment << "\n";
+    }
+    if (!hasHapplyComment) {
+      outStream << "comment " << happlyComment << "\n";
+    }
+
+    // Write obj_info comments
+    for (const std::string& comment : objInfoComments) {
+      outStream << "obj_info " << comment << "\n";
+    }
+
+    // Write elements (and their properties)
+    for (Element& e : elements) {
+      if (countOffsets != nullptr) {
+        countOffsets->push_back(static_cast<size_t>(outStream.tellp() - headerStart) + e.name.size() + 9);
+        e.writeHeader(outStream, 20);
+      } else {
+        e.writeHeader(outStream);
       }
-      intInds.push_back(thisInds);
     }
 
-    // Store
-    getElement(faceName).addListProperty<IndType>("vertex_indices", intInds);
+    // End header
+    outStream << "end_header\n";
   }
+};
 
 
+/**
+ * @brief A read-only, strided view of a property which lives in some other memory (such as a memory-mapped file). No
+ * data is copied; values are decoded when they are accessed.
+ */
+template <class T>
+class PropertyView {
+
+public:
   /**
-   * @brief Comments for the file. When writing, each entry will be written as a sequential comment line.
+   * @brief Create a new view.
+   *
+   * @param data_ Pointer to the first value.
+   * @param count_ Number of values.
+   * @param stride_ Bytes between consecutive values.
+   * @param bigEndian_ Are the values stored big endian?
    */
-  std::vector<std::string> comments;
+  PropertyView(const char* data_, size_t count_, size_t stride_, bool bigEndian_)
+      : dataPtr(data_), count(count_), strideBytes(stride_), bigEndian(bigEndian_) {}
 
+  /**
+   * @brief Get a value. Values need not be aligned in the underlying memory, so they are returned by copy.
+   *
+   * @param i Index of the value.
+   *
+   * @return The value.
+   */
+  T operator[](size_t i) const {
+    T val;
+    std::memcpy(&val, dataPtr + i * strideBytes, sizeof(T));
+    return bigEndian ? swapEndian(val) : val;
+  }
 
   /**
-   * @brief obj_info comments for the file. When writing, each entry will be written as a sequential comment line.
+   * @brief Number of values in the view.
    */
-  std::vector<std::string> objInfoComments;
+  size_t size() const { return count; }
 
-private:
-  std::vector<Element> elements;
-  const int majorVersion = 1; // I'll buy you a drink if these ever get bumped
-  const int minorVersion = 0;
+  /**
+   * @brief Bytes between consecutive values.
+   */
+  size_t stride() const { return strideBytes; }
 
-  DataFormat inputDataFormat = DataFormat::ASCII;  // set when reading from a file
-  DataFormat outputDataFormat = DataFormat::ASCII; // option for writing files
+  /**
+   * @brief Pointer to the first value in the underlying memory.
+   */
+  const char* data() const { return dataPtr; }
 
+  /**
+   * @brief Are the values stored big endian? If so, operator[] swaps them when accessed.
+   */
+  bool isBigEndian() const { return bigEndian; }
 
-  // === Reading ===
+private:
+  const char* dataPtr;
+  size_t count;
+  size_t strideBytes;
+  bool bigEndian;
+};
+
+
+/**
+ * @brief A read-only view of a binary .ply file, which is memory-mapped rather than read. Only the header is parsed;
+ * scalar properties of elements without list properties can then be accessed as strided views directly over the mapped
+ * bytes. Useful for very large files, where only a few properties are needed.
+ */
+class PLYView {
 
+public:
   /**
-   * @brief Parse a PLY file from an input stream
+   * @brief Map a binary .ply file and parse its header. Throws if any failures occur.
    *
-   * @param inStream
-   * @param verbose
+   * @param filename The file to read from.
+   * @param verbose If true, print useful info about the file to stdout
    */
-  void parsePLY(std::istream& inStream, bool verbose) {
-
-    // == Process the header
-    parseHeader(inStream, verbose);
+  PLYView(const std::string& filename, bool verbose = false) : file(filename) {
 
+    if (verbose) std::cout << "PLY parser: Mapping ply file: " << filename << std::endl;
 
-    // === Parse data from a binary file
-    if (inputDataFormat == DataFormat::Binary) {
-      parseBinary(inStream, verbose);
-    }
-    // === Parse data from an binary file
-    else if (inputDataFormat == DataFormat::BinaryBigEndian) {
-      parseBinaryBigEndian(inStream, verbose);
+    // Parse the header in place
+    MemoryStreamBuf headerBuf(file.data(), file.size());
+    std::istream headerStream(&headerBuf);
+    header.parseHeader(headerStream, verbose);
+    if (header.inputDataFormat == DataFormat::ASCII) {
+      throw std::runtime_error("PLY parser: PLYView requires a binary file, " + filename + " is ASCII");
     }
-    // === Parse data from an ASCII file
-    else if (inputDataFormat == DataFormat::ASCII) {
-      parseASCII(inStream, verbose);
+    bool bigEndian = header.inputDataFormat == DataFormat::BinaryBigEndian;
+    comments = header.comments;
+    objInfoComments = header.objInfoComments;
+
+    // Find where each element starts
+    const char* pos = file.data() + headerBuf.consumed();
+    const char* end = file.data() + file.size();
+    for (Element& elem : header.elements) {
+      elementStarts.push_back(pos);
+      size_t stride = elem.fixedStride();
+      size_t nFound = 0;
+      if (stride > 0 && elem.count <= static_cast<size_t>(end - pos) / stride) {
+        pos += elem.count * stride;
+        nFound = elem.count;
+      } else if (stride == 0) {
+        nFound = elem.scanBinaryRecords(pos, end, elem.count, bigEndian);
+      }
+      if (nFound != elem.count) {
+        throw std::runtime_error("PLY parser: unexpected end of file while reading element " + elem.name);
+      }
     }
+
+    if (verbose) std::cout << "  - Finished mapping file." << std::endl;
   }
 
   /**
-   * @brief Read the header for a file
+   * @brief Check if an element type exists
    *
-   * @param inStream
-   * @param verbose
+   * @param target The name to check for.
+   *
+   * @return True if exists.
    */
-  void parseHeader(std::istream& inStream, bool verbose) {
+  bool hasElement(const std::string& target) { return header.hasElement(target); }
 
-    using std::cout;
-    using std::endl;
-    using std::string;
-    using std::vector;
+  /**
+   * @brief A list of the names of all elements
+   *
+   * @return Element names
+   */
+  std::vector<std::string> getElementNames() { return header.getElementNames(); }
 
-    // First two lines are predetermined
-    { // First line is magic constant
-      string plyLine;
-      std::getline(inStream, plyLine);
-      if (trimSpaces(plyLine) != "ply") {
-        throw std::runtime_error("PLY parser: File does not appear to be ply file. First line should be 'ply'");
-      }
-    }
+  /**
+   * @brief The number of entries of an element type
+   *
+   * @param target The name of the element type.
+   *
+   * @return The element count.
+   */
+  size_t getElementCount(const std::string& target) { return header.getElement(target).count; }
 
-    { // second line is version
-      string styleLine;
-      std::getline(inStream, styleLine);
-      vector<string> tokens = tokenSplit(styleLine);
-      if (tokens.size() != 3) throw std::runtime_error("PLY parser: bad format line");
-      std::string formatStr = tokens[0];
-      std::string typeStr = tokens[1];
-      std::string versionStr = tokens[2];
+  /**
+   * @brief A list of the names of all properties of an element type
+   *
+   * @param target The name of the element type.
+   *
+   * @return Property names
+   */
+  std::vector<std::string> getPropertyNames(const std::string& target) {
+    return header.getElement(target).getPropertyNames();
+  }
 
-      // "format"
-      if (formatStr != "format") throw std::runtime_error("PLY parser: bad format line");
+  /**
+   * @brief Get a zero-copy view of a property. The type must match the type in the file exactly (no promotion), the
+   * property must not be a list, and its element must not have any list properties. Throws otherwise. The view is valid
+   * for as long as this PLYView exists.
+   *
+   * @tparam T The type of the property
+   * @param elementName The name of the element type.
+   * @param propertyName The name of the property.
+   *
+   * @return A strided view of the data.
+   */
+  template <class T>
+  PropertyView<T> getPropertyView(const std::string& elementName, const std::string& propertyName) {
 
-      // ascii/binary
-      if (typeStr == "ascii") {
-        inputDataFormat = DataFormat::ASCII;
-        if (verbose) cout << "  - Type: ascii" << endl;
-      } else if (typeStr == "binary_little_endian") {
-        inputDataFormat = DataFormat::Binary;
-        if (verbose) cout << "  - Type: binary" << endl;
-      } else if (typeStr == "binary_big_endian") {
-        inputDataFormat = DataFormat::BinaryBigEndian;
-        if (verbose) cout << "  - Type: binary big endian" << endl;
-      } else {
-        throw std::runtime_error("PLY parser: bad format line");
-      }
+    typedef typename CanonicalName<T>::type Tcan;
 
-      // version
-      if (versionStr != "1.0") {
-        throw std::runtime_error("PLY parser: encountered file with version != 1.0. Don't know how to parse that");
-      }
-      if (verbose) cout << "  - Version: " << versionStr << endl;
+    size_t iElem = 0;
+    while (iElem < header.elements.size() && header.elements[iElem].name != elementName) {
+      iElem++;
+    }
+    if (iElem == header.elements.size()) {
+      throw std::runtime_error("PLY parser: no element with name: " + elementName);
     }
+    Element& elem = header.elements[iElem];
 
-    // Consume header line by line
-    while (inStream.good()) {
-      string line;
-      std::getline(inStream, line);
+    std::unique_ptr<Property>& prop = elem.getPropertyPtr(propertyName);
+    if (dynamic_cast<TypedProperty<Tcan>*>(prop.get()) == nullptr) {
+      throw std::runtime_error("PLY parser: property " + prop->name + " cannot be viewed as type " + typeName<Tcan>() +
+                               ". Has type " + prop->propertyTypeName() + (prop->fixedByteWidth() == 0 ? " list" : ""));
+    }
+    size_t stride = elem.fixedStride();
+    if (stride == 0) {
+      throw std::runtime_error("PLY parser: element " + elem.name +
+                               " has list properties, so its properties cannot be viewed with a fixed stride");
+    }
 
-      // Parse a comment
-      if (startsWith(line, "comment")) {
-        // Skip the comment if it's empty
-        if (line.length() <= 8) continue;
-        string comment = line.substr(8);
-        if (verbose) cout << "  - Comment: " << comment << endl;
-        comments.push_back(comment);
-        continue;
-      }
+    // Find the property within the record
+    size_t offset = 0;
+    for (std::unique_ptr<Property>& p : elem.properties) {
+      if (p == prop) break;
+      offset += p->fixedByteWidth();
+    }
 
-      // Parse an obj_info comment
-      if (startsWith(line, "obj_info")) {
-        // Skip the comment if it's empty
-        if (line.length() <= 9) continue;
-        string infoComment = line.substr(9);
-        if (verbose) cout << "  - obj_info: " << infoComment << endl;
-        objInfoComments.push_back(infoComment);
-        continue;
-      }
+    return PropertyView<T>(elementStarts[iElem] + offset, elem.count, stride,
+                           header.inputDataFormat == DataFormat::BinaryBigEndian);
+  }
 
-      // Parse an element
-      else if (startsWith(line, "element")) {
-        vector<string> tokens = tokenSplit(line);
-        if (tokens.size() != 3) throw std::runtime_error("PLY parser: Invalid element line");
-        string name = tokens[1];
-        size_t count;
-        std::istringstream iss(tokens[2]);
-        iss >> count;
-        elements.emplace_back(name, count);
-        if (verbose) cout << "  - Found element: " << name << " (count = " << count << ")" << endl;
-        continue;
-      }
+  /**
+   * @brief Comments from the file.
+   */
+  std::vector<std::string> comments;
 
-      // Parse a property list
-      else if (startsWith(line, "property list")) {
-        vector<string> tokens = tokenSplit(line);
-        if (tokens.size() != 5) throw std::runtime_error("PLY parser: Invalid property list line");
-        if (elements.size() == 0) throw std::runtime_error("PLY parser: Found property list without previous element");
-        string countType = tokens[2];
-        string type = tokens[3];
-        string name = tokens[4];
-        elements.back().properties.push_back(createPropertyWithType(name, type, true, countType));
-        if (verbose)
-          cout << "    - Found list property: " << name << " (count type = " << countType << ", data type = " << type
-               << ")" << endl;
-        continue;
-      }
+  /**
+   * @brief obj_info comments from the file.
+   */
+  std::vector<std::string> objInfoComments;
+
+private:
+  MappedFile file;
+  PLYData header;                        // holds elements and properties, but no data
+  std::vector<const char*> elementStarts; // the first byte of each element in the mapped file
+};
+
+
+/**
+ * @brief A batch of consecutive records from one element, decoded by a PLYReader. The storage is reused for each batch,
+ * so the values are only valid until the next batch is decoded.
+ */
+class RecordBatch {
 
-      // Parse a property
-      else if (startsWith(line, "property")) {
-        vector<string> tokens = tokenSplit(line);
-        if (tokens.size() != 3) throw std::runtime_error("PLY parser: Invalid property line");
-        if (elements.size() == 0) throw std::runtime_error("PLY parser: Found property without previous element");
-        string type = tokens[1];
-        string name = tokens[2];
-        elements.back().properties.push_back(createPropertyWithType(name, type, false, ""));
-        if (verbose) cout << "    - Found property: " << name << " (type = " << type << ")" << endl;
-        continue;
-      }
+public:
+  /**
+   * @brief Create an empty batch.
+   *
+   * @param maxRecords_ Number of records to decode in to the batch at a time.
+   */
+  RecordBatch(size_t maxRecords_ = 1 << 20) : records("", 0), maxRecords(std::max<size_t>(maxRecords_, 1)) {}
 
-      // Parse end of header
-      else if (startsWith(line, "end_header")) {
-        break;
-      }
+  /**
+   * @brief The decoded records, with one property for each property which is loaded. records.count is the number of
+   * records in the batch.
+   */
+  Element records;
 
-      // Error!
-      else {
-        throw std::runtime_error("Unrecognized header line: " + line);
-      }
+  /**
+   * @brief Index within the element of the first record in the batch.
+   */
+  size_t firstRecord = 0;
+
+  /**
+   * @brief Number of records to decode in to the batch at a time. Every batch of an element has this many records,
+   * except for the last one.
+   */
+  size_t maxRecords;
+
+  /**
+   * @brief Name of the element the records belong to.
+   */
+  const std::string& elementName() const { return records.name; }
+
+  /**
+   * @brief Number of records in the batch.
+   */
+  size_t size() const { return records.count; }
+
+  /**
+   * @brief The values of a property, without copying. The type must match the type in the file exactly.
+   *
+   * @tparam T The type of the property.
+   * @param propertyName The name of the property.
+   *
+   * @return The values, one per record.
+   */
+  template <class T>
+  const std::vector<T>& column(const std::string& propertyName) {
+    TypedProperty<T>* prop = dynamic_cast<TypedProperty<T>*>(records.getPropertyPtr(propertyName).get());
+    if (prop == nullptr) {
+      throw std::runtime_error("PLY reader: property " + propertyName + " does not have type " + typeName<T>());
     }
+    return prop->data;
   }
 
   /**
-   * @brief Read the actual data for a file, in ASCII
+   * @brief The values of a list property, without copying. The type must match the type in the file exactly. The
+   * values of the lists are concatenated in flattenedData, and flattenedIndexStart gives where each one begins.
    *
-   * @param inStream
-   * @param verbose
+   * @tparam T The type of the values in the lists.
+   * @param propertyName The name of the property.
+   *
+   * @return The list property.
    */
-  void parseASCII(std::istream& inStream, bool verbose) {
+  template <class T>
+  const TypedListProperty<T>& listColumn(const std::string& propertyName) {
+    TypedListProperty<T>* prop = dynamic_cast<TypedListProperty<T>*>(records.getPropertyPtr(propertyName).get());
+    if (prop == nullptr) {
+      throw std::runtime_error("PLY reader: property " + propertyName + " is not a list of type " + typeName<T>());
+    }
+    return *prop;
+  }
+};
 
-    using std::string;
-    using std::vector;
 
-    // Read all elements
-    for (Element& elem : elements) {
+/**
+ * @brief Receives the data from a PLYReader as it is decoded. Override the methods for the events of interest.
+ */
+class PLYHandler {
 
-      if (verbose) {
-        std::cout << "  - Processing element: " << elem.name << std::endl;
-      }
+public:
+  virtual ~PLYHandler() {}
 
-      for (size_t iP = 0; iP < elem.properties.size(); iP++) {
-        elem.properties[iP]->reserve(elem.count);
-      }
-      for (size_t iEntry = 0; iEntry < elem.count; iEntry++) {
+  /**
+   * @brief Called as each element begins.
+   *
+   * @param name The name of the element.
+   * @param count The number of records in the element.
+   */
+  virtual void beginElement(const std::string& name, size_t count) {}
+
+  /**
+   * @brief Called with each batch of decoded records.
+   *
+   * @param batch The records, which are only valid until this returns.
+   */
+  virtual void records(RecordBatch& batch) = 0;
 
-        string line;
-        std::getline(inStream, line);
+  /**
+   * @brief Called as each element ends.
+   *
+   * @param name The name of the element.
+   */
+  virtual void endElement(const std::string& name) {}
+};
 
-        // Some .ply files seem to include empty lines before the start of property data (though this is not specified
-        // in the format description). We attempt to recover and parse such files by skipping any empty lines.
-        if (!elem.properties.empty()) { // if the element has no properties, the line _should_ be blank, presumably
-          while (line.empty()) { // skip lines until we hit something nonempty
-            std::getline(inStream, line);
-          }
-        }
 
-        vector<string> tokens = tokenSplit(line);
-        size_t iTok = 0;
-        for (size_t iP = 0; iP < elem.properties.size(); iP++) {
-          elem.properties[iP]->parseNext(tokens, iTok);
-        }
-      }
+/**
+ * @brief A streaming reader for .ply files of any size. Rather than holding the whole file in memory like PLYData, the
+ * records of each element are decoded in batches and handed to a PLYHandler, so that only one batch is in memory at a
+ * time.
+ */
+class PLYReader {
+
+public:
+  /**
+   * @brief Open a file and parse its header. Throws if any failures occur.
+   *
+   * @param filename_ The file to read.
+   * @param options Options for reading. Throws if `lazy` or any bindings are given, which streaming does not support.
+   */
+  PLYReader(const std::string& filename_, const ReadOptions& options = ReadOptions())
+      : ownedStream(new std::ifstream(filename_, std::ios::binary)), stream(*ownedStream), filename(filename_) {
+    if (stream.fail()) {
+      throw std::runtime_error("PLY reader: Could not open file " + filename);
     }
+    readHeader(options);
   }
 
   /**
-   * @brief Read the actual data for a file, in binary.
+   * @brief Parse the header of a file from a stream. Throws if any failures occur. The stream must outlive the reader.
    *
-   * @param inStream
-   * @param verbose
+   * @param stream_ The stream to read from.
+   * @param options Options for reading. Throws if `lazy` or any bindings are given, as for reading a file, and also if
+   * `asyncIO` or `pageCache` are set, which need a file.
    */
-  void parseBinary(std::istream& inStream, bool verbose) {
-
-    if (!isLittleEndian()) {
-      throw std::runtime_error("binary reading assumes little endian system");
-    }
+  PLYReader(std::istream& stream_, const ReadOptions& options = ReadOptions()) : stream(stream_) {
+    readHeader(options);
+  }
 
-    using std::string;
-    using std::vector;
+  /**
+   * @brief List the names of the elements which will be read.
+   */
+  std::vector<std::string> getElementNames() { return header.getElementNames(); }
 
-    // Read all elements
-    for (Element& elem : elements) {
+  /**
+   * @brief The number of records in an element.
+   *
+   * @param elementName The name of the element.
+   */
+  size_t getElementCount(const std::string& elementName) { return header.getElement(elementName).count; }
 
-      if (verbose) {
-        std::cout << "  - Processing element: " << elem.name << std::endl;
-      }
+  /**
+   * @brief Read the rest of the file, passing each element to a handler as it is decoded. Can not be combined with
+   * next().
+   *
+   * @param handler The handler.
+   * @param batchRecords Number of records in each batch (except the last of each element).
+   */
+  void read(PLYHandler& handler, size_t batchRecords = 1 << 20) {
+    if (started) {
+      throw std::runtime_error("PLY reader: the file has already been read");
+    }
 
-      for (size_t iP = 0; iP < elem.properties.size(); iP++) {
-        elem.properties[iP]->reserve(elem.count);
-      }
-      for (size_t iEntry = 0; iEntry < elem.count; iEntry++) {
-        for (size_t iP = 0; iP < elem.properties.size(); iP++) {
-          elem.properties[iP]->readNext(inStream);
-        }
+    RecordBatch batch(batchRecords);
+    while (beginElement()) {
+      handler.beginElement(current->name, current->count);
+      while (nextInElement(batch)) {
+        handler.records(batch);
       }
+      handler.endElement(current->name);
     }
   }
 
   /**
-   * @brief Read the actual data for a file, in binary.
+   * @brief Decode the next batch of records, continuing from the previous one. Batches come in order through the file,
+   * one element after another; check RecordBatch::elementName() to tell them apart. Elements with no records give no
+   * batches. Can not be combined with read().
    *
-   * @param inStream
-   * @param verbose
+   * @param batch The batch to decode in to. It should be reused for each call, to reuse its storage.
+   *
+   * @return False once the end of the file has been reached.
+   */
+  bool next(RecordBatch& batch) {
+    while (true) {
+      if (current == nullptr && !beginElement()) return false;
+      if (nextInElement(batch)) return true;
+      current = nullptr;
+    }
+  }
+
+  /**
+   * @brief Comments from the file.
    */
-  void parseBinaryBigEndian(std::istream& inStream, bool verbose) {
+  std::vector<std::string> comments;
 
-    if (!isLittleEndian()) {
+  /**
+   * @brief obj_info comments from the file.
+   */
+  std::vector<std::string> objInfoComments;
+
+private:
+  // Parse the header and set up which elements and properties to read
+  void readHeader(const ReadOptions& options) {
+    if (options.lazy) {
+      throw std::runtime_error("PLY reader: lazy loading is not supported when streaming");
+    }
+    if (!options.bindings.empty()) {
+      throw std::runtime_error("PLY reader: bound properties are not supported when streaming, use the batches");
+    }
+    if (options.asyncIO || options.pageCache != PageCacheMode::Default) {
+#if defined(_WIN32)
+      throw std::runtime_error("PLY reader: asyncIO and pageCache are not supported on Windows");
+#else
+      if (filename.empty()) {
+        throw std::runtime_error("PLY reader: asyncIO and pageCache are only supported when reading from a file");
+      }
+#endif
+    }
+    header.parseHeader(stream, options.verbose);
+    header.applyReadOptions(options);
+    if (header.inputDataFormat != DataFormat::ASCII && !isLittleEndian()) {
       throw std::runtime_error("binary reading assumes little endian system");
     }
+    comments = header.comments;
+    objInfoComments = header.objInfoComments;
+  }
 
-    using std::string;
-    using std::vector;
-
-    // Read all elements
-    for (Element& elem : elements) {
+  // Move on to the next element which is loaded, skipping over any others
+  bool beginElement() {
+    if (!started) {
+      started = true;
+      const ReadOptions& options = header.readOptions;
+#if !defined(_WIN32)
+      if (options.asyncIO || options.pageCache != PageCacheMode::Default) {
+        std::unique_ptr<ReadAhead> fileReads(
+            new FileReadAhead(filename, stream, options.bufferBytes, 4, options.asyncIO, options.pageCache));
+        source.reset(new BufferedReader(stream, options.bufferBytes, std::move(fileReads)));
+      }
+#endif
+      if (!source) source.reset(new BufferedReader(stream, options.bufferBytes, options.prefetch));
+    }
+    current = nullptr;
+    blockReader.reset();
+    if (!source) return false;
+
+    while (nextFile < header.fileOrder.size()) {
+      size_t iFile = nextFile++;
+      Element& elem = header.fileElement(iFile);
+      if (header.fileOrder[iFile] < 0) {
+        header.skipElement(*source, elem);
+        continue;
+      }
 
-      if (verbose) {
-        std::cout << "  - Processing element: " << elem.name << std::endl;
+      current = &elem;
+      load = header.propertiesToLoad(iFile);
+      nextRecord = 0;
+      preparedBatch = nullptr;
+      if (header.inputDataFormat != DataFormat::ASCII) {
+        plan = header.getDecodePlan(elem, load, header.inputDataFormat == DataFormat::BinaryBigEndian);
+        size_t nThreads = header.readOptions.threads;
+        blockReader.reset(new RecordBlockReader(*source, elem, *plan, nThreads * header.readOptions.bufferBytes,
+                                                plan->stride > 0 ? 1 : nThreads));
       }
+      return true;
+    }
+
+    // That was the last element
+    source->release();
+    source.reset();
+    header.finishReading();
+    return false;
+  }
+
+  // Decode the next batch of the current element, if it has any records left
+  bool nextInElement(RecordBatch& batch) {
+    Element& elem = *current;
+    if (nextRecord >= elem.count) {
+      if (blockReader) blockReader->next(); // finishes with the last block
+      return false;
+    }
 
+    // The batch holds empty copies of the properties which are loaded, which are refilled for each batch
+    if (preparedBatch != &batch || batch.records.name != elem.name) {
+      batch.records = Element(elem.name, 0);
+      destinations.assign(elem.properties.size(), nullptr);
       for (size_t iP = 0; iP < elem.properties.size(); iP++) {
-        elem.properties[iP]->reserve(elem.count);
+        if (!load[iP]) continue;
+        batch.records.properties.push_back(elem.properties[iP]->emptyCopy());
+        destinations[iP] = batch.records.properties.back().get();
       }
-      for (size_t iEntry = 0; iEntry < elem.count; iEntry++) {
-        for (size_t iP = 0; iP < elem.properties.size(); iP++) {
-          elem.properties[iP]->readNextBigEndian(inStream);
-        }
+      preparedBatch = &batch;
+    }
+
+    size_t nRecords;
+    if (header.inputDataFormat == DataFormat::ASCII) {
+      nRecords = std::min(batch.maxRecords, elem.count - nextRecord);
+      for (std::unique_ptr<Property>& prop : batch.records.properties) {
+        prop->resize(0);
+        prop->resizeValues(0);
+      }
+      header.parseASCIIRecords(*source, elem, destinations, nRecords);
+    } else {
+      blockReader->next(batch.maxRecords, true);
+      nRecords = blockReader->size();
+      for (std::unique_ptr<Property>& prop : batch.records.properties) {
+        prop->resize(nRecords);
       }
+      BlockDecoder decoder(*plan, destinations, header.readOptions.threads);
+      decoder.decode(*blockReader, 0);
     }
+
+    batch.records.count = nRecords;
+    batch.firstRecord = nextRecord;
+    nextRecord += nRecords;
+    return true;
   }
 
-  // === Writing ===
+  std::unique_ptr<std::istream> ownedStream; // the file, if the reader opened it
+  std::istream& stream;
+  std::string filename; // the file, if reading from one
+  PLYData header;       // holds elements and properties, but no data
+
+  // Reading state
+  bool started = false;
+  std::unique_ptr<BufferedReader> source; // null before starting and after finishing
+  size_t nextFile = 0;                    // position in the file of the next element to begin
+  Element* current = nullptr;             // the element being read, if any
+  std::vector<bool> load;                 // which properties of the current element are loaded
+  size_t nextRecord = 0;                  // index of the next record of the current element
+  std::shared_ptr<const DecodePlan> plan;
+  std::unique_ptr<RecordBlockReader> blockReader;
+  RecordBatch* preparedBatch = nullptr; // the batch which destinations point in to
+  std::vector<Property*> destinations;  // for each property of the current element, where it is decoded to
+};
 
 
+/**
+ * @brief A streaming writer for .ply files of any size. Rather than building a whole PLYData first, declare the
+ * elements and properties, then hand over the records of each element in batches, in order; they are written out as
+ * they arrive. Element counts need not be known up front, in which case they are filled in to the header by close().
+ */
+class PLYWriter {
+
+public:
   /**
-   * @brief write a PLY file to an output stream
+   * @brief Create a file to write to.
    *
-   * @param outStream
+   * @param filename The file to write to.
+   * @param format The format to use (binary or ascii?)
+   * @param options_ Options controlling how the file is written.
    */
-  void writePLY(std::ostream& outStream) {
+  PLYWriter(const std::string& filename, DataFormat format = DataFormat::ASCII,
+            const WriteOptions& options_ = WriteOptions())
+      : ownedStream(new std::ofstream(filename, std::ios::out | std::ios::binary)), stream(*ownedStream),
+        options(options_), buffer(stream, options.bufferBytes), asciiOut(buffer, options.precision) {
+    if (!stream.good()) {
+      throw std::runtime_error("Ply writer: Could not open output file " + filename + " for writing");
+    }
+    header.outputDataFormat = format;
+  }
 
-    writeHeader(outStream);
+  /**
+   * @brief Write to a stream, which must outlive the writer. It must support seeking if any element counts are not
+   * known up front.
+   *
+   * @param stream_ The stream to write to.
+   * @param format The format to use (binary or ascii?)
+   * @param options_ Options controlling how the file is written.
+   */
+  PLYWriter(std::ostream& stream_, DataFormat format = DataFormat::ASCII, const WriteOptions& options_ = WriteOptions())
+      : stream(stream_), options(options_), buffer(stream, options.bufferBytes), asciiOut(buffer, options.precision) {
+    header.outputDataFormat = format;
+  }
 
-    // Write all elements
-    for (Element& e : elements) {
-      if (outputDataFormat == DataFormat::Binary) {
-        if (!isLittleEndian()) {
-          throw std::runtime_error("binary writing assumes little endian system");
-        }
-        e.writeDataBinary(outStream);
-      } else if (outputDataFormat == DataFormat::BinaryBigEndian) {
-        if (!isLittleEndian()) {
-          throw std::runtime_error("binary writing assumes little endian system");
-        }
-        e.writeDataBinaryBigEndian(outStream);
-      } else if (outputDataFormat == DataFormat::ASCII) {
-        e.writeDataASCII(outStream);
-      }
+  /**
+   * @brief Finishes the file with close() if that has not been done. Errors are ignored; call close() to see them.
+   */
+  ~PLYWriter() {
+    if (closed) return;
+    try {
+      close();
+    } catch (...) {
     }
   }
 
+  PLYWriter(const PLYWriter&) = delete;
+  PLYWriter& operator=(const PLYWriter&) = delete;
 
   /**
-   * @brief Write out a header for a file
+   * @brief Declare an element, whose number of records is not known yet. Elements are written in the order they are
+   * declared.
    *
-   * @param outStream
+   * @param name The name of the element.
    */
-  void writeHeader(std::ostream& outStream) {
+  void addElement(const std::string& name) {
+    addElement(name, 0);
+    countKnown.back() = false;
+  }
 
-    // Magic line
-    outStream << "ply\n";
+  /**
+   * @brief Declare an element with a known number of records. Elements are written in the order they are declared.
+   *
+   * @param name The name of the element.
+   * @param count The number of records which will be written.
+   */
+  void addElement(const std::string& name, size_t count) {
+    checkDeclaring();
+    if (header.hasElement(name)) {
+      throw std::runtime_error("Ply writer: element " + name + " is declared twice");
+    }
+    header.addElement(name, count);
+    countKnown.push_back(true);
+  }
 
-    // Type line
-    outStream << "format ";
-    if (outputDataFormat == DataFormat::Binary) {
-      outStream << "binary_little_endian ";
-    } else if (outputDataFormat == DataFormat::BinaryBigEndian) {
-      outStream << "binary_big_endian ";
-    } else if (outputDataFormat == DataFormat::ASCII) {
-      outStream << "ascii ";
+  /**
+   * @brief Declare a property of an element. Properties are written in the order they are declared.
+   *
+   * @tparam T The type of the property.
+   * @param elementName The name of the element.
+   * @param propertyName The name of the property.
+   */
+  template <class T>
+  void addProperty(const std::string& elementName, const std::string& propertyName) {
+    addProperty(elementName, std::unique_ptr<Property>(new TypedProperty<typename CanonicalName<T>::type>(propertyName)));
+  }
+
+  /**
+   * @brief Declare a list property of an element. Properties are written in the order they are declared.
+   *
+   * @tparam T The type of the values in the lists.
+   * @param elementName The name of the element.
+   * @param propertyName The name of the property.
+   */
+  template <class T>
+  void addListProperty(const std::string& elementName, const std::string& propertyName) {
+    addProperty(elementName,
+                std::unique_ptr<Property>(new TypedListProperty<typename CanonicalName<T>::type>(propertyName, 1)));
+  }
+
+  /**
+   * @brief Write a batch of records. Records must be written one element after another, in the order the elements were
+   * declared; starting on an element finishes those before it. The batch must have the declared properties of its
+   * element, in the same order and with the same types (a RecordBatch from a PLYReader has them if none are projected
+   * away).
+   *
+   * @param records The records, as an element with the same name as the declared one.
+   */
+  void write(Element& records) {
+    if (closed) {
+      throw std::runtime_error("Ply writer: the file has already been closed");
     }
+    if (!headerWritten) writeHeader();
 
-    // Version number
-    outStream << majorVersion << "." << minorVersion << "\n";
+    // Move on to the records' element, finishing any before it
+    size_t iElement = 0;
+    while (iElement < header.elements.size() && header.elements[iElement].name != records.name) iElement++;
+    if (iElement == header.elements.size()) {
+      throw std::runtime_error("Ply writer: element " + records.name + " was not declared");
+    }
+    if (iElement < current) {
+      throw std::runtime_error("Ply writer: element " + records.name + " has already been finished");
+    }
+    while (current < iElement) finishElement();
 
-    // Write comments
-    bool hasHapplyComment = false;
-    std::string happlyComment = "Written with hapPLY (https://github.com/nmwsharp/happly)";
-    for (const std::string& comment : comments) {
-      if (comment == happlyComment) hasHapplyComment = true;
-      outStream << "comment " << comment << "\n";
+    // Check the records against the declaration
+    Element& declared = header.elements[current];
+    records.validate();
+    if (records.properties.size() != declared.properties.size()) {
+      throw std::runtime_error("Ply writer: records of element " + records.name + " have the wrong number of properties");
     }
-    if (!hasHapplyComment) {
-      outStream << "comment " << happlyComment << "\n";
+    for (size_t iP = 0; iP < declared.properties.size(); iP++) {
+      Property& want = *declared.properties[iP];
+      Property& have = *records.properties[iP];
+      if (have.name != want.name || have.propertyTypeName() != want.propertyTypeName() ||
+          (have.listStartStorage() == nullptr) != (want.listStartStorage() == nullptr)) {
+        throw std::runtime_error("Ply writer: records of element " + records.name + " have property " + have.name +
+                                 ", but " + want.name + " was declared");
+      }
+    }
+    if (countKnown[current] && written + records.count > declared.count) {
+      throw std::runtime_error("Ply writer: too many records for element " + records.name);
     }
 
-    // Write obj_info comments
-    for (const std::string& comment : objInfoComments) {
-      outStream << "obj_info " << comment << "\n";
+    header.writeElementData(records, buffer, asciiOut, options);
+    written += records.count;
+  }
+
+  /**
+   * @brief Finish the file: finish any elements not written yet, flush everything out to the stream, and fill in the
+   * element counts which were not known up front. Elements which got no records are empty.
+   */
+  void close() {
+    if (closed) return;
+    closed = true;
+    if (!headerWritten) writeHeader();
+    while (current < header.elements.size()) finishElement();
+    buffer.flush();
+
+    // Fill in the counts, now that they are known
+    if (!countOffsets.empty()) {
+      for (size_t iE = 0; iE < header.elements.size(); iE++) {
+        if (countKnown[iE]) continue;
+        std::string countStr = std::to_string(header.elements[iE].count);
+        stream.seekp(headerStart + static_cast<std::streamoff>(countOffsets[iE]));
+        stream.write(countStr.data(), countStr.size());
+      }
+      stream.seekp(0, std::ios_base::end);
     }
+    stream.flush();
+    if (!stream.good()) {
+      throw std::runtime_error("Ply writer: failed to write to the stream");
+    }
+  }
 
-    // Write elements (and their properties)
-    for (Element& e : elements) {
-      e.writeHeader(outStream);
+  /**
+   * @brief Comments to write in to the file. Must be set before any records are written.
+   */
+  std::vector<std::string> comments;
+
+  /**
+   * @brief obj_info comments to write in to the file. Must be set before any records are written.
+   */
+  std::vector<std::string> objInfoComments;
+
+private:
+  // Throw if it is too late to change the header
+  void checkDeclaring() {
+    if (headerWritten) {
+      throw std::runtime_error("Ply writer: elements and properties must be declared before any records are written");
     }
+  }
 
-    // End header
-    outStream << "end_header\n";
+  void addProperty(const std::string& elementName, std::unique_ptr<Property> prop) {
+    checkDeclaring();
+    Element& elem = header.getElement(elementName);
+    for (std::unique_ptr<Property>& p : elem.properties) {
+      if (p->name == prop->name) {
+        throw std::runtime_error("Ply writer: property " + prop->name + " of element " + elementName +
+                                 " is declared twice");
+      }
+    }
+    elem.properties.push_back(std::move(prop));
   }
+
+  // Write the header, leaving room to fill in any counts which are not known yet
+  void writeHeader() {
+    headerWritten = true;
+    header.comments = comments;
+    header.objInfoComments = objInfoComments;
+
+    bool anyUnknown = std::find(countKnown.begin(), countKnown.end(), false) != countKnown.end();
+    std::ostringstream text;
+    header.writeHeader(text, anyUnknown ? &countOffsets : nullptr);
+    if (anyUnknown) {
+      headerStart = stream.tellp();
+      if (headerStart == std::ostream::pos_type(-1)) {
+        throw std::runtime_error("Ply writer: element counts which are not known up front need a seekable stream");
+      }
+    }
+    std::string headerText = text.str();
+    stream.write(headerText.data(), headerText.size());
+  }
+
+  // Finish the current element, checking that it got all of its records
+  void finishElement() {
+    Element& elem = header.elements[current];
+    if (!countKnown[current]) {
+      elem.count = written;
+    } else if (written != elem.count) {
+      throw std::runtime_error("Ply writer: element " + elem.name + " was declared with " + std::to_string(elem.count) +
+                               " records, but " + std::to_string(written) + " were written");
+    }
+    current++;
+    written = 0;
+  }
+
+  std::unique_ptr<std::ostream> ownedStream; // the file, if the writer opened it
+  std::ostream& stream;
+  WriteOptions options;
+  PLYData header; // holds elements and properties, but no data
+  BufferedWriter buffer;
+  ASCIIWriter asciiOut;
+
+  // Writing state
+  std::vector<bool> countKnown;      // for each element, whether its count was declared
+  std::vector<size_t> countOffsets;  // where each count is in the header, if any need filling in
+  std::ostream::pos_type headerStart; // where the header starts in the stream
+  bool headerWritten = false;
+  bool closed = false;
+  size_t current = 0; // the element being written
+  size_t written = 0; // number of records of the current element written so far
 };
 
 } // namespace happly
@@ -21,6 +21,27 @@ void DoubleArrayVecEq(std::vector<std::array<double, 3>>& arr1, std::vector<std:
     }
   }
 }
+// A stream buffer which, like a pipe, hands out data in small pieces and cannot seek
+class PipeStreamBuf : public std::streambuf {
+public:
+  PipeStreamBuf(const std::string& contents_) : contents(contents_) {}
+
+protected:
+  int_type underflow() override {
+    if (pos >= contents.size()) return traits_type::eof();
+    size_t n = std::min<size_t>(5, contents.size() - pos);
+    std::copy(contents.begin() + pos, contents.begin() + pos + n, piece);
+    setg(piece, piece, piece + n);
+    pos += n;
+    return traits_type::to_int_type(piece[0]);
+  }
+
+private:
+  std::string contents;
+  size_t pos = 0;
+  char piece[5];
+};
+
 // void VecEq(std::vector<double>& arr1, std::vector<double>& arr2) {
 // EXPECT_EQ(arr1.size(), arr2.size());
 // for (size_t i = 0; i < arr1.size(); i++) {
@@ -307,8 +328,8 @@ TEST(TypedReadWriteTest, ReadWriteFloatASCII) {
       std::numeric_limits<float>::max(),
       std::numeric_limits<float>::lowest(),
       std::numeric_limits<float>::epsilon(),
-      // std::numeric_limits<float>::infinity(),     // these DO NOT work right now, due to how ostream works
-      //-std::numeric_limits<float>::infinity(),
+      std::numeric_limits<float>::infinity(),
+      -std::numeric_limits<float>::infinity(),
       0.0f,
       -0.0f,
       1e24f,
@@ -388,8 +409,8 @@ TEST(TypedReadWriteTest, ReadWriteDoubleASCII) {
       std::numeric_limits<double>::max(),
       std::numeric_limits<double>::lowest(),
       std::numeric_limits<double>::epsilon(),
-      // std::numeric_limits<double>::infinity(),     // these DO NOT work right now, due to how ostream works
-      //-std::numeric_limits<double>::infinity(),
+      std::numeric_limits<double>::infinity(),
+      -std::numeric_limits<double>::infinity(),
       0.0,
       -0.0,
       1e24,
@@ -457,6 +478,40 @@ TEST(TypedReadWriteTest, ReadWriteDoubleBinarySwap) {
 }
 
 
+// = many values of each width, big endian (exercises the batched byte swapping, including leftover values)
+TEST(TypedReadWriteTest, ReadWriteManyBinarySwap) {
+
+  size_t N = 1037;
+  std::vector<short> dataS(N);
+  std::vector<unsigned int> dataI(N);
+  std::vector<double> dataD(N);
+  std::vector<std::vector<float>> dataL(N);
+  for (size_t i = 0; i < N; i++) {
+    dataS[i] = static_cast<short>(i * 31 - 16000);
+    dataI[i] = static_cast<unsigned int>(i) * 2654435761u;
+    dataD[i] = static_cast<double>(i) * 1.0e-3 - 7.;
+    dataL[i] = std::vector<float>(i % 11, static_cast<float>(i) * 0.5f);
+  }
+
+  // Separate elements, so each property is contiguous in the file
+  happly::PLYData plyOut;
+  plyOut.addElement("short_elem", N);
+  plyOut.getElement("short_elem").addProperty<short>("s", dataS);
+  plyOut.addElement("int_elem", N);
+  plyOut.getElement("int_elem").addProperty<unsigned int>("i", dataI);
+  plyOut.addElement("double_elem", N);
+  plyOut.getElement("double_elem").addProperty<double>("d", dataD);
+  plyOut.addElement("list_elem", N);
+  plyOut.getElement("list_elem").addListProperty<float>("l", dataL);
+
+  plyOut.write("temp.ply", happly::DataFormat::BinaryBigEndian);
+  happly::PLYData plyIn("temp.ply");
+  EXPECT_EQ(dataS, plyIn.getElement("short_elem").getProperty<short>("s"));
+  EXPECT_EQ(dataI, plyIn.getElement("int_elem").getProperty<unsigned int>("i"));
+  EXPECT_EQ(dataD, plyIn.getElement("double_elem").getProperty<double>("d"));
+  EXPECT_EQ(dataL, plyIn.getElement("list_elem").getListProperty<float>("l"));
+}
+
 // = signed char list
 TEST(TypedListReadWriteTest, ReadWriteCharASCII) {
 
@@ -961,6 +1016,1252 @@ TEST(TypedListReadWriteTest, ReadWriteDoubleBinarySwap) {
   EXPECT_EQ(testData, testDataBinary);
 }
 
+// = mixed properties on one element
+TEST(MultiPropertyReadWriteTest, ReadWriteMixedBinary) {
+
+  // Create a file with many records of interleaved types (enough to span several read blocks)
+  size_t N = 500000;
+  std::vector<char> dataC(N);
+  std::vector<unsigned short> dataS(N);
+  std::vector<int> dataI(N);
+  std::vector<float> dataF(N);
+  std::vector<double> dataD(N);
+  for (size_t i = 0; i < N; i++) {
+    dataC[i] = static_cast<char>(i % 200 - 100);
+    dataS[i] = static_cast<unsigned short>(i % 60000);
+    dataI[i] = static_cast<int>(i) * 7 - 1000;
+    dataF[i] = static_cast<float>(i) * 0.25f;
+    dataD[i] = static_cast<double>(i) * -1.5;
+  }
+
+  happly::PLYData plyOut;
+  plyOut.addElement("test_elem", N);
+  plyOut.getElement("test_elem").addProperty<char>("c", dataC);
+  plyOut.getElement("test_elem").addProperty<unsigned short>("s", dataS);
+  plyOut.getElement("test_elem").addProperty<int>("i", dataI);
+  plyOut.getElement("test_elem").addProperty<float>("f", dataF);
+  plyOut.getElement("test_elem").addProperty<double>("d", dataD);
+
+  for (happly::DataFormat format : {happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+    plyOut.write("temp.ply", format);
+    happly::PLYData plyIn("temp.ply");
+    EXPECT_EQ(dataC, plyIn.getElement("test_elem").getProperty<char>("c"));
+    EXPECT_EQ(dataS, plyIn.getElement("test_elem").getProperty<unsigned short>("s"));
+    EXPECT_EQ(dataI, plyIn.getElement("test_elem").getProperty<int>("i"));
+    EXPECT_EQ(dataF, plyIn.getElement("test_elem").getProperty<float>("f"));
+    EXPECT_EQ(dataD, plyIn.getElement("test_elem").getProperty<double>("d"));
+  }
+}
+
+// = many records with list properties
+TEST(MultiPropertyReadWriteTest, ReadWriteListsBinary) {
+
+  // Mostly triangles with the occasional other polygon, plus a second list whose length varies on every record
+  size_t N = 300000;
+  std::vector<std::vector<int>> faceInds(N);
+  std::vector<std::vector<unsigned char>> tags(N);
+  std::vector<float> quality(N);
+  for (size_t i = 0; i < N; i++) {
+    size_t degree = (i % 997 == 0) ? (i % 7) : 3;
+    for (size_t j = 0; j < degree; j++) {
+      faceInds[i].push_back(static_cast<int>(i + j));
+    }
+    for (size_t j = 0; j < i % 5; j++) {
+      tags[i].push_back(static_cast<unsigned char>(i + j));
+    }
+    quality[i] = static_cast<float>(i) * 0.5f;
+  }
+
+  happly::PLYData plyOut;
+  plyOut.addElement("face", N);
+  plyOut.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+  plyOut.getElement("face").addProperty<float>("quality", quality);
+  plyOut.getElement("face").addListProperty<unsigned char>("tags", tags);
+
+  for (happly::DataFormat format : {happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+    plyOut.write("temp.ply", format);
+
+    // Read with one thread and with several
+    for (size_t nThreads : {1, 4}) {
+      happly::ReadOptions options;
+      options.threads = nThreads;
+      happly::PLYData plyIn("temp.ply", options);
+      EXPECT_EQ(faceInds, plyIn.getElement("face").getListProperty<int>("vertex_indices"));
+      EXPECT_EQ(quality, plyIn.getElement("face").getProperty<float>("quality"));
+      EXPECT_EQ(tags, plyIn.getElement("face").getListProperty<unsigned char>("tags"));
+    }
+  }
+}
+
+// === Test multi-threaded reading
+TEST(ThreadedReadTest, FixedStrideMatchesSerial) {
+
+  // Interleaved scalar types, enough records that each block is split between threads
+  size_t N = 500000;
+  std::vector<char> dataC(N);
+  std::vector<unsigned short> dataS(N);
+  std::vector<int> dataI(N);
+  std::vector<double> dataD(N);
+  for (size_t i = 0; i < N; i++) {
+    dataC[i] = static_cast<char>(i % 200 - 100);
+    dataS[i] = static_cast<unsigned short>(i % 60000);
+    dataI[i] = static_cast<int>(i) * 7 - 1000;
+    dataD[i] = static_cast<double>(i) * -1.5;
+  }
+  happly::PLYData plyOut;
+  plyOut.addElement("test_elem", N);
+  plyOut.getElement("test_elem").addProperty<char>("c", dataC);
+  plyOut.getElement("test_elem").addProperty<unsigned short>("s", dataS);
+  plyOut.getElement("test_elem").addProperty<int>("i", dataI);
+  plyOut.getElement("test_elem").addProperty<double>("d", dataD);
+
+  for (happly::DataFormat format : {happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+    plyOut.write("temp.ply", format);
+    happly::ReadOptions options;
+    options.threads = 4;
+    happly::PLYData plyIn("temp.ply", options);
+    EXPECT_EQ(dataC, plyIn.getElement("test_elem").getProperty<char>("c"));
+    EXPECT_EQ(dataS, plyIn.getElement("test_elem").getProperty<unsigned short>("s"));
+    EXPECT_EQ(dataI, plyIn.getElement("test_elem").getProperty<int>("i"));
+    EXPECT_EQ(dataD, plyIn.getElement("test_elem").getProperty<double>("d"));
+  }
+}
+
+// === Test memory-mapped views
+TEST(PLYViewTest, ViewBinary) {
+
+  // A list element comes first, so the view has to walk it to find the vertices
+  happly::PLYData plyOut;
+  std::vector<std::vector<int>> faceInds{{0, 1, 2}, {2, 1, 3, 4}, {}, {1, 1, 1}};
+  plyOut.addElement("face", faceInds.size());
+  plyOut.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+  std::vector<float> dataX{1.5f, -2.f, 3.25f, 4.f, 1e6f};
+  std::vector<unsigned char> dataC{1, 2, 3, 200, 255};
+  std::vector<double> dataD{0.1, 0.2, -0.3, 1e-200, 77.};
+  plyOut.addElement("vertex", dataX.size());
+  plyOut.getElement("vertex").addProperty<float>("x", dataX);
+  plyOut.getElement("vertex").addProperty<unsigned char>("c", dataC);
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+
+  for (happly::DataFormat format : {happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+    plyOut.write("temp.ply", format);
+    happly::PLYView view("temp.ply");
+
+    EXPECT_EQ(view.getElementCount("vertex"), dataX.size());
+    happly::PropertyView<float> viewX = view.getPropertyView<float>("vertex", "x");
+    happly::PropertyView<unsigned char> viewC = view.getPropertyView<unsigned char>("vertex", "c");
+    happly::PropertyView<double> viewD = view.getPropertyView<double>("vertex", "d");
+    ASSERT_EQ(viewX.size(), dataX.size());
+    EXPECT_EQ(viewX.stride(), sizeof(float) + sizeof(unsigned char) + sizeof(double));
+    for (size_t i = 0; i < dataX.size(); i++) {
+      EXPECT_EQ(dataX[i], viewX[i]);
+      EXPECT_EQ(dataC[i], viewC[i]);
+      EXPECT_EQ(dataD[i], viewD[i]);
+    }
+
+    // No type promotion, and no views of list properties
+    EXPECT_THROW(view.getPropertyView<double>("vertex", "x"), std::runtime_error);
+    EXPECT_THROW(view.getPropertyView<int>("face", "vertex_indices"), std::runtime_error);
+  }
+}
+
+TEST(PLYViewTest, ViewASCIIThrows) {
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", 2);
+  plyOut.getElement("vertex").addProperty<float>("x", std::vector<float>{1.f, 2.f});
+  plyOut.write("temp.ply", happly::DataFormat::ASCII);
+  EXPECT_THROW(happly::PLYView view("temp.ply"), std::runtime_error);
+}
+
+TEST(PLYViewTest, ViewHeaderOnly) {
+  // No elements, and no newline after end_header
+  {
+    std::ofstream out("temp.ply", std::ios::binary);
+    out << "ply\nformat binary_little_endian 1.0\nend_header";
+  }
+  happly::PLYView view("temp.ply");
+  EXPECT_TRUE(view.getElementNames().empty());
+  EXPECT_THROW(view.getPropertyView<float>("vertex", "x"), std::runtime_error);
+}
+
+// === Test views of loaded data
+TEST(SpanTest, ViewPropertyDataInPlace) {
+  happly::PLYData plyOut;
+  std::vector<float> dataF{1.f, -2.5f, 3.f};
+  plyOut.addElement("vertex", dataF.size());
+  plyOut.getElement("vertex").addProperty<float>("x", dataF);
+  happly::Element& vertex = plyOut.getElement("vertex");
+
+  // A view of the stored values, not a copy
+  happly::DataSpan<const float> x = vertex.getPropertySpan<float>("x");
+  ASSERT_EQ(x.size(), dataF.size());
+  EXPECT_EQ(dataF, std::vector<float>(x.begin(), x.end()));
+  EXPECT_EQ(x.data(), vertex.getPropertySpan<float>("x").data());
+
+  // Changes made through a mutable view are seen by everything else
+  happly::DataSpan<float> xMut = vertex.getMutablePropertySpan<float>("x");
+  xMut[1] = 7.f;
+  for (float& v : xMut) v *= 2.f;
+  EXPECT_EQ(std::vector<float>({2.f, 14.f, 6.f}), vertex.getProperty<float>("x"));
+  EXPECT_EQ(x[1], 14.f);
+
+  // The type must match exactly, and the property must exist
+  EXPECT_THROW(vertex.getPropertySpan<double>("x"), std::runtime_error);
+  EXPECT_THROW(vertex.getMutablePropertySpan<int>("x"), std::runtime_error);
+  EXPECT_THROW(vertex.getPropertySpan<float>("y"), std::runtime_error);
+}
+
+TEST(SpanTest, ViewListPropertyFlat) {
+  happly::PLYData plyOut;
+  std::vector<std::vector<int>> faces{{0, 1, 2}, {}, {2, 3, 4, 5}};
+  plyOut.addElement("face", faces.size());
+  plyOut.getElement("face").addListProperty<int>("vertex_indices", faces);
+  happly::Element& face = plyOut.getElement("face");
+
+  // A flat view of the stored lists, not a copy
+  happly::ListSpan<const int> lists = face.getListPropertySpan<int>("vertex_indices");
+  ASSERT_EQ(lists.size(), faces.size());
+  for (size_t i = 0; i < faces.size(); i++) {
+    EXPECT_EQ(faces[i], std::vector<int>(lists[i].begin(), lists[i].end()));
+  }
+  EXPECT_EQ(lists.flattenedData().size(), 7u);
+  EXPECT_EQ(std::vector<size_t>({0, 3, 3, 7}),
+            std::vector<size_t>(lists.flattenedIndexStart().begin(), lists.flattenedIndexStart().end()));
+
+  // Values can be changed in place through a mutable view
+  happly::ListSpan<int> listsMut = face.getMutableListPropertySpan<int>("vertex_indices");
+  listsMut[2][0] = 9;
+  EXPECT_EQ(lists[2][0], 9);
+  EXPECT_EQ(9, face.getListProperty<int>("vertex_indices")[2][0]);
+
+  // The type must match exactly, and the property must exist
+  EXPECT_THROW(face.getListPropertySpan<unsigned int>("vertex_indices"), std::runtime_error);
+  EXPECT_THROW(face.getMutableListPropertySpan<int>("vertex_index"), std::runtime_error);
+}
+
+// === Test lazy loading
+TEST(LazyLoadTest, LazyLoadMatchesEager) {
+
+  // Elements after a list element, so the lazy reader has to walk the list counts to find them
+  happly::PLYData plyOut;
+  std::vector<std::vector<int>> faceInds{{0, 1, 2}, {2, 1, 3, 4}, {}, {1, 1, 1}};
+  plyOut.addElement("face", faceInds.size());
+  plyOut.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+  std::vector<float> dataX{1.5f, -2.f, 3.25f, 4.f, 1e6f};
+  std::vector<double> dataD{0.1, 0.2, -0.3, 1e-200, 77.};
+  plyOut.addElement("vertex", dataX.size());
+  plyOut.getElement("vertex").addProperty<float>("x", dataX);
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+  std::vector<int> dataI{7, 8};
+  plyOut.addElement("other", dataI.size());
+  plyOut.getElement("other").addProperty<int>("i", dataI);
+
+  happly::ReadOptions options;
+  options.lazy = true;
+
+  for (happly::DataFormat format :
+       {happly::DataFormat::ASCII, happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+    plyOut.write("temp.ply", format);
+
+    // Access elements out of order
+    happly::PLYData plyIn("temp.ply", options);
+    EXPECT_EQ(plyIn.getElementNames(), std::vector<std::string>({"face", "vertex", "other"}));
+    EXPECT_EQ(dataI, plyIn.getElement("other").getProperty<int>("i"));
+    EXPECT_EQ(dataX, plyIn.getElement("vertex").getProperty<float>("x"));
+    EXPECT_EQ(dataD, plyIn.getElement("vertex").getProperty<double>("d"));
+    EXPECT_EQ(faceInds, plyIn.getElement("face").getListProperty<int>("vertex_indices"));
+
+    // Writing loads anything which is missing
+    happly::PLYData plyIn2("temp.ply", options);
+    std::stringstream ioBuffer;
+    plyIn2.write(ioBuffer, happly::DataFormat::Binary);
+    happly::PLYData plyIn3(ioBuffer);
+    EXPECT_EQ(dataD, plyIn3.getElement("vertex").getProperty<double>("d"));
+    EXPECT_EQ(faceInds, plyIn3.getElement("face").getListProperty<int>("vertex_indices"));
+  }
+}
+
+TEST(LazyLoadTest, RetryAfterFailedLoad) {
+  happly::PLYData plyOut;
+  std::vector<int> dataI{1, 2, 3};
+  plyOut.addElement("vertex", dataI.size());
+  plyOut.getElement("vertex").addProperty<int>("i", dataI);
+  std::stringstream ioBuffer;
+  plyOut.write(ioBuffer, happly::DataFormat::ASCII);
+  std::string bytes = ioBuffer.str();
+  std::string tail = bytes.substr(bytes.size() - 2); // the last record, "3\n"
+  {
+    std::ofstream out("temp.ply", std::ios::binary);
+    out << bytes.substr(0, bytes.size() - 2);
+  }
+
+  happly::ReadOptions options;
+  options.lazy = true;
+  happly::PLYData plyIn("temp.ply", options);
+  EXPECT_THROW(plyIn.getElement("vertex"), std::runtime_error);
+
+  // Once the file is complete, the retry sees each record once
+  {
+    std::ofstream out("temp.ply", std::ios::binary | std::ios::app);
+    out << tail;
+  }
+  EXPECT_EQ(dataI, plyIn.getElement("vertex").getProperty<int>("i"));
+
+  // A bad value in one element does not stop later elements from loading, though they are found by reading past it
+  std::vector<float> dataF{0.5f, -1.f};
+  plyOut.addElement("other", dataF.size());
+  plyOut.getElement("other").addProperty<float>("f", dataF);
+  std::stringstream badBuffer;
+  plyOut.write(badBuffer, happly::DataFormat::ASCII);
+  std::string bad = badBuffer.str();
+  bad[bad.find("end_header\n") + 11] = 'x';
+  {
+    std::ofstream out("temp.ply", std::ios::binary);
+    out << bad;
+  }
+  happly::PLYData plyBad("temp.ply", options);
+  EXPECT_THROW(plyBad.getElement("vertex"), std::runtime_error);
+  EXPECT_EQ(dataF, plyBad.getElement("other").getProperty<float>("f"));
+}
+
+TEST(LazyLoadTest, LazyStreamThrows) {
+  std::stringstream ioBuffer;
+  happly::ReadOptions options;
+  options.lazy = true;
+  EXPECT_THROW(happly::PLYData plyIn(ioBuffer, options), std::runtime_error);
+}
+
+// === Test projection
+TEST(ProjectionTest, LoadOnlyRequested) {
+
+  happly::PLYData plyOut;
+  std::vector<std::vector<int>> faceInds{{0, 1, 2}, {2, 1, 3, 4}, {}, {1, 1, 1}};
+  std::vector<unsigned char> faceFlags{1, 2, 3, 4};
+  plyOut.addElement("face", faceInds.size());
+  plyOut.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+  plyOut.getElement("face").addProperty<unsigned char>("flags", faceFlags);
+  std::vector<float> dataX{1.5f, -2.f, 3.25f, 4.f, 1e6f};
+  std::vector<float> dataY{0.f, 1.f, 2.f, 3.f, 4.f};
+  std::vector<double> dataD{0.1, 0.2, -0.3, 1e-200, 77.};
+  plyOut.addElement("vertex", dataX.size());
+  plyOut.getElement("vertex").addProperty<float>("x", dataX);
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+  plyOut.getElement("vertex").addProperty<float>("y", dataY);
+  std::vector<int> dataI{7, 8};
+  plyOut.addElement("other", dataI.size());
+  plyOut.getElement("other").addProperty<int>("i", dataI);
+
+  happly::ReadOptions options;
+  options.projection["vertex"] = {"x", "y"};
+  options.projection["face"] = {"flags"};
+
+  for (bool lazy : {false, true}) {
+    options.lazy = lazy;
+    for (happly::DataFormat format :
+         {happly::DataFormat::ASCII, happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+      plyOut.write("temp.ply", format);
+      happly::PLYData plyIn("temp.ply", options);
+
+      EXPECT_EQ(plyIn.getElementNames(), std::vector<std::string>({"face", "vertex"}));
+      EXPECT_EQ(plyIn.getElement("vertex").getPropertyNames(), std::vector<std::string>({"x", "y"}));
+      EXPECT_EQ(dataX, plyIn.getElement("vertex").getProperty<float>("x"));
+      EXPECT_EQ(dataY, plyIn.getElement("vertex").getProperty<float>("y"));
+      EXPECT_EQ(plyIn.getElement("face").getPropertyNames(), std::vector<std::string>({"flags"}));
+      EXPECT_EQ(faceFlags, plyIn.getElement("face").getProperty<unsigned char>("flags"));
+      plyIn.validate();
+    }
+  }
+}
+
+// === Test sharing compiled decode plans
+TEST(DecodePlanTest, CacheSharedBetweenFiles) {
+
+  happly::ReadOptions options;
+  options.planCache = std::make_shared<happly::DecodePlanCache>();
+
+  // Several files with the same header but different data should all decode with the same two plans
+  for (int iFile = 0; iFile < 3; iFile++) {
+    std::vector<float> dataX{1.5f * iFile, -2.f, 3.25f};
+    std::vector<unsigned char> dataC{1, 2, static_cast<unsigned char>(iFile)};
+    std::vector<std::vector<int>> faceInds{{0, 1, 2}, std::vector<int>(iFile, 7), {2, 1, 0, 1}};
+
+    happly::PLYData plyOut;
+    plyOut.addElement("vertex", dataX.size());
+    plyOut.getElement("vertex").addProperty<float>("x", dataX);
+    plyOut.getElement("vertex").addProperty<unsigned char>("c", dataC);
+    plyOut.addElement("face", faceInds.size());
+    plyOut.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+    plyOut.write("temp.ply", happly::DataFormat::BinaryBigEndian);
+
+    happly::PLYData plyIn("temp.ply", options);
+    EXPECT_EQ(dataX, plyIn.getElement("vertex").getProperty<float>("x"));
+    EXPECT_EQ(dataC, plyIn.getElement("vertex").getProperty<unsigned char>("c"));
+    EXPECT_EQ(faceInds, plyIn.getElement("face").getListProperty<int>("vertex_indices"));
+    EXPECT_EQ(options.planCache->size(), 2);
+  }
+
+  // Loading different properties needs a different plan
+  options.projection["vertex"] = {"c"};
+  options.projection["face"] = {};
+  happly::PLYData plyIn("temp.ply", options);
+  EXPECT_EQ(plyIn.getElement("vertex").getPropertyNames(), std::vector<std::string>({"c"}));
+  EXPECT_EQ(options.planCache->size(), 3);
+}
+
+// === Test buffered reading
+TEST(BufferedReadTest, PipesAndSmallBuffers) {
+
+  happly::PLYData plyOut;
+  std::vector<std::vector<int>> faceInds{{0, 1, 2}, {2, 1, 3, 4}, {}, {1, 1, 1}};
+  plyOut.addElement("face", faceInds.size());
+  plyOut.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+  std::vector<double> dataD{0.1, 0.2, -0.3, 1e-200, 77.};
+  plyOut.addElement("vertex", dataD.size());
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+
+  // Buffers much smaller than a record, so that everything spans several reads
+  happly::ReadOptions options;
+  options.bufferBytes = 3;
+
+  for (bool prefetch : {false, true}) {
+    for (happly::DataFormat format :
+         {happly::DataFormat::ASCII, happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+      options.prefetch = prefetch;
+      std::stringstream ioBuffer;
+      plyOut.write(ioBuffer, format);
+
+      // A stream which cannot seek
+      PipeStreamBuf pipeBuf(ioBuffer.str());
+      std::istream pipe(&pipeBuf);
+      happly::PLYData plyPipe(pipe, options);
+      EXPECT_EQ(faceInds, plyPipe.getElement("face").getListProperty<int>("vertex_indices"));
+      EXPECT_EQ(dataD, plyPipe.getElement("vertex").getProperty<double>("d"));
+
+      // A stream with more after the file, which should be left unread
+      std::stringstream withTrailer(ioBuffer.str() + "trailer");
+      happly::PLYData plyIn(withTrailer, options);
+      EXPECT_EQ(dataD, plyIn.getElement("vertex").getProperty<double>("d"));
+      std::string rest;
+      withTrailer >> rest;
+      EXPECT_EQ(rest, "trailer");
+    }
+  }
+}
+
+TEST(BufferedReadTest, PrefetchLazyAndLarge) {
+
+  // Enough data for the reader to run many blocks ahead
+  std::vector<int> dataI(100000);
+  for (size_t i = 0; i < dataI.size(); i++) dataI[i] = static_cast<int>(i * 7 - 3);
+  std::vector<std::vector<int>> faceInds;
+  for (size_t i = 0; i < 5000; i++) faceInds.push_back(std::vector<int>(i % 5, static_cast<int>(i)));
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", dataI.size());
+  plyOut.getElement("vertex").addProperty<int>("i", dataI);
+  plyOut.addElement("face", faceInds.size());
+  plyOut.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+
+  happly::ReadOptions options;
+  options.prefetch = true;
+  options.bufferBytes = 1000;
+
+  for (happly::DataFormat format : {happly::DataFormat::ASCII, happly::DataFormat::Binary}) {
+    std::stringstream ioBuffer;
+    plyOut.write(ioBuffer, format);
+
+    happly::PLYData plyIn(ioBuffer, options);
+    EXPECT_EQ(dataI, plyIn.getElement("vertex").getProperty<int>("i"));
+    EXPECT_EQ(faceInds, plyIn.getElement("face").getListProperty<int>("vertex_indices"));
+
+    // Lazy loads skip over elements with the read-ahead running, and must land in the right place
+    std::string filename = "temp_prefetch.ply";
+    plyOut.write(filename, format);
+    happly::ReadOptions lazyOptions = options;
+    lazyOptions.lazy = true;
+    happly::PLYData plyLazy(filename, lazyOptions);
+    EXPECT_EQ(faceInds, plyLazy.getElement("face").getListProperty<int>("vertex_indices"));
+    EXPECT_EQ(dataI, plyLazy.getElement("vertex").getProperty<int>("i"));
+  }
+}
+
+#if !defined(_WIN32)
+TEST(BufferedReadTest, AsyncFileReads) {
+
+  // A file of several blocks, read through io_uring (where available) and through plain reads
+  size_t n = 60000;
+  std::vector<double> dataD(n);
+  std::vector<std::vector<int>> dataL(n);
+  for (size_t i = 0; i < n; i++) {
+    dataD[i] = 0.5 * static_cast<double>(i);
+    dataL[i] = std::vector<int>(i % 5, static_cast<int>(i));
+  }
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", n);
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+  plyOut.addElement("face", n);
+  plyOut.getElement("face").addListProperty<int>("l", dataL);
+
+  for (happly::DataFormat format : {happly::DataFormat::ASCII, happly::DataFormat::BinaryBigEndian}) {
+    plyOut.write("temp.ply", format);
+    happly::ReadOptions options;
+    options.asyncIO = true;
+    options.bufferBytes = 1 << 13;
+    happly::PLYData plyIn("temp.ply", options);
+    EXPECT_EQ(dataD, plyIn.getElement("vertex").getProperty<double>("d"));
+    EXPECT_EQ(dataL, plyIn.getElement("face").getListProperty<int>("l"));
+  }
+
+  // Reading directly, in odd sizes, leaves the stream just after what was handed out
+  std::ifstream whole("temp.ply", std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(whole)), std::istreambuf_iterator<char>());
+  for (bool useRing : {true, false}) {
+    std::ifstream in("temp.ply", std::ios::binary);
+    in.seekg(100);
+    happly::FileReadAhead reader("temp.ply", in, 1000, 3, useRing);
+    std::string got;
+    std::vector<char> chunk(777);
+    for (int i = 0; i < 50; i++) {
+      size_t nRead = reader.read(chunk.data(), chunk.size());
+      got.append(chunk.data(), nRead);
+    }
+    EXPECT_EQ(bytes.substr(100, got.size()), got);
+    reader.stop();
+    EXPECT_EQ(static_cast<size_t>(in.tellg()), 100 + got.size());
+
+    std::ifstream inAll("temp.ply", std::ios::binary);
+    happly::FileReadAhead readerAll("temp.ply", inAll, 4096, 4, useRing);
+    std::vector<char> all(bytes.size() + 10);
+    EXPECT_EQ(readerAll.read(all.data(), all.size()), bytes.size());
+    EXPECT_EQ(bytes, std::string(all.data(), bytes.size()));
+  }
+}
+
+TEST(BufferedReadTest, PageCacheModes) {
+
+  // Larger than the amount dropped at a time, so that pages are dropped part way through
+  size_t n = 3000000;
+  std::vector<double> dataD(n);
+  std::vector<std::vector<int>> dataL(n / 10);
+  for (size_t i = 0; i < n; i++) {
+    dataD[i] = static_cast<double>(i) - 7.5;
+  }
+  for (size_t i = 0; i < dataL.size(); i++) {
+    dataL[i] = std::vector<int>(i % 4, static_cast<int>(i));
+  }
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", n);
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+  plyOut.addElement("face", dataL.size());
+  plyOut.getElement("face").addListProperty<int>("l", dataL);
+
+  for (size_t nThreads : {1, 2}) {
+    happly::WriteOptions writeOptions;
+    writeOptions.pageCache = happly::PageCacheMode::DropBehind;
+    writeOptions.threads = nThreads;
+    writeOptions.bufferBytes = 1 << 20;
+    plyOut.write("temp.ply", happly::DataFormat::Binary, writeOptions);
+
+    for (happly::PageCacheMode mode : {happly::PageCacheMode::Sequential, happly::PageCacheMode::DropBehind}) {
+      for (bool asyncIO : {false, true}) {
+        happly::ReadOptions options;
+        options.pageCache = mode;
+        options.asyncIO = asyncIO;
+        options.bufferBytes = 1 << 20;
+        happly::PLYData plyIn("temp.ply", options);
+        EXPECT_EQ(dataD, plyIn.getElement("vertex").getProperty<double>("d"));
+        EXPECT_EQ(dataL, plyIn.getElement("face").getListProperty<int>("l"));
+      }
+    }
+  }
+}
+#endif
+
+TEST(BufferedReadTest, ReadFromMemory) {
+
+  happly::PLYData plyOut;
+  std::vector<std::vector<int>> faceInds{{0, 1, 2}, {2, 1, 3, 4}, {}, {1, 1, 1}};
+  plyOut.addElement("face", faceInds.size());
+  plyOut.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+  std::vector<double> dataD{0.1, 0.2, -0.3, 1e-200, 77.};
+  plyOut.addElement("vertex", dataD.size());
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+  plyOut.comments.push_back("from memory");
+
+  for (happly::DataFormat format :
+       {happly::DataFormat::ASCII, happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+    std::stringstream ioBuffer;
+    plyOut.write(ioBuffer, format);
+    std::string bytes = ioBuffer.str();
+
+    happly::ReadOptions options;
+    options.bufferBytes = 5;
+    happly::PLYData plyIn(bytes.data(), bytes.size(), options);
+    EXPECT_EQ(faceInds, plyIn.getElement("face").getListProperty<int>("vertex_indices"));
+    EXPECT_EQ(dataD, plyIn.getElement("vertex").getProperty<double>("d"));
+    EXPECT_EQ(plyIn.comments.front(), "from memory");
+
+    // Cut off partway through the last element
+    happly::ReadOptions defaults;
+    EXPECT_THROW(happly::PLYData(bytes.data(), bytes.size() - 8, defaults), std::runtime_error);
+  }
+
+  // A header with nothing after it, not even a newline
+  std::string headerOnly = "ply\nformat binary_little_endian 1.0\nelement vertex 0\nproperty float x\nend_header";
+  happly::ReadOptions defaults;
+  happly::PLYData plyEmpty(headerOnly.data(), headerOnly.size(), defaults);
+  EXPECT_TRUE(plyEmpty.getElement("vertex").getProperty<float>("x").empty());
+  std::string truncated = "ply\nformat binary_little_endian 1.0\nelement vertex 2\nproperty float x\nend_header";
+  EXPECT_THROW(happly::PLYData(truncated.data(), truncated.size(), defaults), std::runtime_error);
+}
+
+TEST(BindTest, DecodeInToCallerMemory) {
+
+  std::vector<float> dataX{1.f, 2.f, 3.f, 4.f, 5.f};
+  std::vector<float> dataY{-1.f, -2.f, -3.f, -4.f, -5.f};
+  std::vector<float> dataD{0.5f, 0.25f, 0.125f, -8.f, 1e10f};
+  std::vector<std::vector<int>> faceInds{{0, 1, 2}, {2, 1, 3, 4}, {}};
+  std::vector<unsigned char> faceFlags{7, 8, 9};
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", dataX.size());
+  plyOut.getElement("vertex").addProperty<float>("x", dataX);
+  plyOut.getElement("vertex").addProperty<float>("d", dataD);
+  plyOut.getElement("vertex").addProperty<float>("y", dataY);
+  plyOut.addElement("face", faceInds.size());
+  plyOut.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+  plyOut.getElement("face").addProperty<unsigned char>("flag", faceFlags);
+
+  // An interleaved vertex buffer, with room to spare
+  struct Vertex {
+    float pos[2];
+    double d;
+    int marker;
+  };
+
+  for (happly::DataFormat format :
+       {happly::DataFormat::ASCII, happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+    std::stringstream ioBuffer;
+    plyOut.write(ioBuffer, format);
+
+    std::vector<Vertex> vertices(8, Vertex{{0.f, 0.f}, 0., -1});
+    std::vector<unsigned char> flags(3);
+    happly::ReadOptions options;
+    options.bind("vertex", "x", &vertices[0].pos[0], vertices.size(), sizeof(Vertex));
+    options.bind("vertex", "y", &vertices[0].pos[1], vertices.size(), sizeof(Vertex));
+    options.bind("vertex", "d", &vertices[0].d, vertices.size(), sizeof(Vertex)); // converted from float
+    options.bind("face", "flag", flags.data(), flags.size());
+    options.bind("face", "missing", flags.data(), flags.size());
+    happly::PLYData plyIn(ioBuffer, options);
+
+    for (size_t i = 0; i < dataX.size(); i++) {
+      EXPECT_EQ(vertices[i].pos[0], dataX[i]);
+      EXPECT_EQ(vertices[i].pos[1], dataY[i]);
+      EXPECT_EQ(vertices[i].d, static_cast<double>(dataD[i]));
+      EXPECT_EQ(vertices[i].marker, -1);
+    }
+    EXPECT_EQ(vertices[dataX.size()].pos[0], 0.f);
+    EXPECT_EQ(flags, faceFlags);
+    EXPECT_EQ(faceInds, plyIn.getElement("face").getListProperty<int>("vertex_indices"));
+
+    // Bound properties are not kept in the object
+    EXPECT_FALSE(plyIn.getElement("vertex").hasProperty("x"));
+    EXPECT_FALSE(plyIn.getElement("face").hasProperty("flag"));
+
+    // Memory which is too small, and lists, cannot be bound
+    std::stringstream again(ioBuffer.str());
+    happly::ReadOptions tooSmall;
+    tooSmall.bind("vertex", "x", &vertices[0].pos[0], 4, sizeof(Vertex));
+    EXPECT_THROW(happly::PLYData(again, tooSmall), std::runtime_error);
+    std::stringstream againList(ioBuffer.str());
+    happly::ReadOptions list;
+    list.bind("face", "vertex_indices", flags.data(), flags.size());
+    EXPECT_THROW(happly::PLYData(againList, list), std::runtime_error);
+  }
+}
+
+TEST(ASCIIParseTest, WhitespaceAndNumberForms) {
+  std::string text = "ply\r\nformat ascii 1.0\r\nelement vertex 4\r\nproperty float x\r\nproperty double y\r\n"
+                     "property uchar c\r\nproperty list uchar int l\r\nelement face 1\r\nproperty int i\r\nend_header\r\n"
+                     "1.5\t-2e-3  255 2 -7 +8\r\n"
+                     "\t.25 1E+2 0 0\r\n"
+                     "\r\n"
+                     "-inf NaN 7 1 3.9\r\n"
+                     "  0.1 0.30000000000000004 12 0 \t \r\n"
+                     "42";
+  std::stringstream in(text);
+  happly::PLYData plyIn(in);
+
+  std::vector<float> x = plyIn.getElement("vertex").getProperty<float>("x");
+  std::vector<double> y = plyIn.getElement("vertex").getProperty<double>("y");
+  EXPECT_EQ(x[0], 1.5f);
+  EXPECT_EQ(x[1], 0.25f);
+  EXPECT_EQ(x[2], -std::numeric_limits<float>::infinity());
+  EXPECT_EQ(x[3], 0.1f);
+  EXPECT_EQ(y[0], -2e-3);
+  EXPECT_EQ(y[1], 100.);
+  EXPECT_TRUE(std::isnan(y[2]));
+  EXPECT_EQ(y[3], 0.30000000000000004);
+  std::vector<unsigned char> c{255, 0, 7, 12};
+  EXPECT_EQ(plyIn.getElement("vertex").getProperty<unsigned char>("c"), c);
+  std::vector<std::vector<int>> l{{-7, 8}, {}, {3}, {}}; // like operator>>, "3.9" read as an int is 3
+  EXPECT_EQ(plyIn.getElement("vertex").getListProperty<int>("l"), l);
+  EXPECT_EQ(plyIn.getElement("face").getProperty<int>("i"), std::vector<int>{42});
+}
+
+TEST(ASCIIParseTest, IntegerRange) {
+  std::string header =
+      "ply\nformat ascii 1.0\nelement vertex 1\nproperty char c\nproperty uint u\nproperty int i\nend_header\n";
+
+  // The ends of each range are read exactly
+  std::stringstream in(header + "-128 4294967295 -2147483648\n");
+  happly::PLYData plyIn(in);
+  happly::Element& vertex = plyIn.getElement("vertex");
+  EXPECT_EQ(vertex.getProperty<signed char>("c"), std::vector<signed char>{-128});
+  EXPECT_EQ(vertex.getProperty<unsigned int>("u"), std::vector<unsigned int>{4294967295u});
+  EXPECT_EQ(vertex.getProperty<int>("i"), std::vector<int>{std::numeric_limits<int>::min()});
+
+  // Anything past them is an error, rather than wrapping around
+  for (std::string bad : {"128 0 0", "0 4294967296 0", "0 -1 0", "0 0 99999999999", "0 0 -2147483649",
+                          "0 99999999999999999999999 0"}) {
+    std::stringstream inBad(header + bad + "\n");
+    EXPECT_THROW(happly::PLYData plyBad(inBad), std::runtime_error) << bad;
+  }
+}
+
+TEST(ASCIIParseTest, ParallelMatchesSerial) {
+
+  // Enough records to be split between threads, with lists of varying length, and a property which is skipped
+  size_t n = 100000;
+  std::vector<double> dataD(n);
+  std::vector<int> dataI(n);
+  std::vector<std::vector<unsigned int>> dataL(n);
+  for (size_t i = 0; i < n; i++) {
+    dataD[i] = 0.1 * static_cast<double>(i) - 17.;
+    dataI[i] = static_cast<int>(i % 1000) - 500;
+    dataL[i] = std::vector<unsigned int>(i % 4, static_cast<unsigned int>(i));
+  }
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", n);
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+  plyOut.getElement("vertex").addListProperty<unsigned int>("l", dataL);
+  plyOut.getElement("vertex").addProperty<int>("i", dataI);
+  std::stringstream ioBuffer;
+  plyOut.write(ioBuffer, happly::DataFormat::ASCII);
+  std::string text = ioBuffer.str();
+  text.insert(text.find("end_header\n") + 11, "\n\n"); // blank lines before the data
+
+  happly::ReadOptions options;
+  options.threads = 3;
+  options.bufferBytes = 1 << 14;
+  std::stringstream in(text);
+  happly::PLYData plyIn(in, options);
+  EXPECT_EQ(dataD, plyIn.getElement("vertex").getProperty<double>("d"));
+  EXPECT_EQ(dataL, plyIn.getElement("vertex").getListProperty<unsigned int>("l"));
+  EXPECT_EQ(dataI, plyIn.getElement("vertex").getProperty<int>("i"));
+
+  // Skipping properties
+  options.projection["vertex"] = {"i"};
+  std::stringstream inProjected(text);
+  happly::PLYData plyProjected(inProjected, options);
+  EXPECT_EQ(dataI, plyProjected.getElement("vertex").getProperty<int>("i"));
+
+  // Running out of lines, and a bad value partway through
+  options.projection.clear();
+  std::stringstream truncated(text.substr(0, text.size() - 1000));
+  EXPECT_THROW(happly::PLYData(truncated, options), std::runtime_error);
+  std::string bad = text;
+  bad[bad.find('\n', bad.size() / 2) + 1] = 'x';
+  std::stringstream inBad(bad);
+  EXPECT_THROW(happly::PLYData(inBad, options), std::runtime_error);
+}
+
+TEST(ASCIIWriteTest, ParallelMatchesSerial) {
+
+  // Enough records for several batches, with lists of varying length and an element too small to split
+  size_t n = 300000;
+  std::vector<float> dataF(n);
+  std::vector<std::vector<int>> dataL(n);
+  for (size_t i = 0; i < n; i++) {
+    dataF[i] = 0.1f * static_cast<float>(i) - 17.f;
+    dataL[i] = std::vector<int>(i % 4, static_cast<int>(i) - 1000);
+  }
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", n);
+  plyOut.getElement("vertex").addProperty<float>("f", dataF);
+  plyOut.getElement("vertex").addListProperty<int>("l", dataL);
+  plyOut.addElement("small", 3);
+  plyOut.getElement("small").addProperty<int>("i", std::vector<int>{1, 2, 3});
+
+  std::stringstream serial;
+  plyOut.write(serial, happly::DataFormat::ASCII);
+
+  happly::WriteOptions options;
+  options.threads = 3;
+  options.bufferBytes = 1 << 12;
+  std::stringstream parallel;
+  plyOut.write(parallel, happly::DataFormat::ASCII, options);
+  EXPECT_EQ(serial.str(), parallel.str());
+
+  // Errors from a thread reach the caller
+  dataL[n - 1] = std::vector<int>(300, 0);
+  plyOut.getElement("vertex").addListProperty<int>("l", dataL);
+  std::stringstream tooLong;
+  EXPECT_THROW(plyOut.write(tooLong, happly::DataFormat::ASCII, options), std::runtime_error);
+}
+
+TEST(ASCIIWriteTest, ShortestAndFixedPrecision) {
+  happly::PLYData plyOut;
+  std::vector<double> dataD{0.1, 1e24, -2.5e-300, 123456789., 0.30000000000000004};
+  std::vector<float> dataF{0.1f, 3.14159274f, 1e-45f, -7.f, 16777216.f};
+  plyOut.addElement("vertex", dataD.size());
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+  plyOut.getElement("vertex").addProperty<float>("f", dataF);
+
+  // The shortest text which reads back exactly
+  std::stringstream shortest;
+  plyOut.write(shortest, happly::DataFormat::ASCII);
+  std::string text = shortest.str();
+  EXPECT_NE(text.find("\n0.1 0.1\n1e+24 3.1415927\n-2.5e-300 1e-45\n123456789 -7\n0.30000000000000004 1.6777216e+07\n"),
+            std::string::npos);
+  happly::PLYData plyIn(shortest);
+  EXPECT_EQ(dataD, plyIn.getElement("vertex").getProperty<double>("d"));
+  EXPECT_EQ(dataF, plyIn.getElement("vertex").getProperty<float>("f"));
+
+  // Random values of every magnitude still round trip exactly
+  std::mt19937_64 rng(11);
+  std::vector<double> randomD;
+  while (randomD.size() < 10000) {
+    uint64_t bits = rng();
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    if (std::isfinite(d)) randomD.push_back(d);
+  }
+  happly::PLYData plyRandom;
+  plyRandom.addElement("vertex", randomD.size());
+  plyRandom.getElement("vertex").addProperty<double>("d", randomD);
+  std::stringstream randomText;
+  plyRandom.write(randomText, happly::DataFormat::ASCII);
+  happly::PLYData plyRandomIn(randomText);
+  EXPECT_EQ(randomD, plyRandomIn.getElement("vertex").getProperty<double>("d"));
+
+  // Lossy, with a fixed number of significant digits
+  happly::WriteOptions options;
+  options.precision = 3;
+  std::stringstream fixed;
+  plyOut.write(fixed, happly::DataFormat::ASCII, options);
+  EXPECT_NE(fixed.str().find("\n0.1 0.1\n1e+24 3.14\n-2.5e-300 1.4e-45\n123000000 -7\n0.3 1.68e+07\n"),
+            std::string::npos);
+}
+
+TEST(ASCIIWriteTest, ElementToStream) {
+  // Writing an element straight to a stream gives the same text as in a whole file
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", 3);
+  plyOut.getElement("vertex").addProperty<double>("d", std::vector<double>{0.1, -2.5e-300, 3.});
+  plyOut.getElement("vertex").addListProperty<int>("l", std::vector<std::vector<int>>{{1, 2}, {}, {-3}});
+  std::stringstream file;
+  plyOut.write(file, happly::DataFormat::ASCII);
+  std::string text = file.str();
+
+  std::stringstream element;
+  plyOut.getElement("vertex").writeDataASCII(element);
+  EXPECT_EQ(text.substr(text.find("end_header\n") + 11), element.str());
+}
+
+TEST(BinaryWriteTest, PackedMatchesPerValue) {
+
+  // An element of mixed width scalars, and one with lists, written both ways in both byte orders
+  size_t n = 70000;
+  std::vector<unsigned char> dataU(n);
+  std::vector<short> dataS(n);
+  std::vector<double> dataD(n);
+  std::vector<std::vector<float>> dataL(n);
+  for (size_t i = 0; i < n; i++) {
+    dataU[i] = static_cast<unsigned char>(i);
+    dataS[i] = static_cast<short>(i * 7);
+    dataD[i] = 0.5 * static_cast<double>(i) - 3.;
+    dataL[i] = std::vector<float>(i % 5, static_cast<float>(i));
+  }
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", n);
+  plyOut.getElement("vertex").addProperty<unsigned char>("u", dataU);
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+  plyOut.getElement("vertex").addProperty<short>("s", dataS);
+  plyOut.addElement("face", n);
+  plyOut.getElement("face").addProperty<short>("s", dataS);
+  plyOut.getElement("face").addListProperty<float>("l", dataL);
+
+  for (happly::DataFormat format : {happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+    bool bigEndian = format == happly::DataFormat::BinaryBigEndian;
+    std::stringstream packed;
+    plyOut.write(packed, format);
+    std::string bytes = packed.str();
+    std::string body = bytes.substr(bytes.find("end_header\n") + 11);
+
+    // The same records, encoded one value at a time
+    std::string perValue;
+    auto put = [&](const void* value, size_t width) {
+      std::string valueBytes(static_cast<const char*>(value), width);
+      if (bigEndian) std::reverse(valueBytes.begin(), valueBytes.end());
+      perValue += valueBytes;
+    };
+    for (size_t i = 0; i < n; i++) {
+      put(&dataU[i], sizeof(unsigned char));
+      put(&dataD[i], sizeof(double));
+      put(&dataS[i], sizeof(short));
+    }
+    for (size_t i = 0; i < n; i++) {
+      put(&dataS[i], sizeof(short));
+      unsigned char count = static_cast<unsigned char>(dataL[i].size());
+      put(&count, 1);
+      for (float v : dataL[i]) put(&v, sizeof(float));
+    }
+    EXPECT_EQ(perValue, body);
+
+    happly::PLYData plyIn(packed);
+    EXPECT_EQ(dataD, plyIn.getElement("vertex").getProperty<double>("d"));
+    EXPECT_EQ(dataS, plyIn.getElement("face").getProperty<short>("s"));
+    EXPECT_EQ(dataL, plyIn.getElement("face").getListProperty<float>("l"));
+  }
+}
+
+TEST(BinaryWriteTest, ParallelMatchesSerial) {
+
+  // Elements large enough to split, with and without lists, one too small to split, and one which is empty
+  size_t n = 100000;
+  std::vector<float> dataF(n);
+  std::vector<int> dataI(n);
+  std::vector<std::vector<unsigned int>> dataL(n);
+  for (size_t i = 0; i < n; i++) {
+    dataF[i] = 0.25f * static_cast<float>(i);
+    dataI[i] = static_cast<int>(i) - 50000;
+    dataL[i] = std::vector<unsigned int>(i % 7, static_cast<unsigned int>(i));
+  }
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", n);
+  plyOut.getElement("vertex").addProperty<float>("f", dataF);
+  plyOut.getElement("vertex").addProperty<int>("i", dataI);
+  plyOut.addElement("face", n);
+  plyOut.getElement("face").addListProperty<unsigned int>("l", dataL);
+  plyOut.getElement("face").addProperty<int>("i", dataI);
+  plyOut.addElement("small", 2);
+  plyOut.getElement("small").addProperty<int>("i", std::vector<int>{1, 2});
+  plyOut.addElement("empty", 0);
+
+  auto readFile = [](const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  };
+  happly::WriteOptions options;
+  options.threads = 3;
+  for (happly::DataFormat format : {happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+    plyOut.write("temp.ply", format);
+    std::string serial = readFile("temp.ply");
+    plyOut.write("temp.ply", format, options);
+    EXPECT_EQ(serial, readFile("temp.ply"));
+  }
+
+  // Lists too long for their count are still caught
+  dataL[n / 2] = std::vector<unsigned int>(300, 0);
+  plyOut.getElement("face").addListProperty<unsigned int>("l", dataL);
+  EXPECT_THROW(plyOut.write("temp.ply", happly::DataFormat::Binary, options), std::runtime_error);
+}
+
+#if defined(__linux__)
+TEST(BinaryWriteTest, MappedFileIsAllocated) {
+  // The blocks are allocated before anything is written, so running out of space throws rather than faulting later
+  size_t size = 1 << 20;
+  happly::MappedOutputFile out("temp.ply", size);
+  struct stat info;
+  ASSERT_EQ(0, stat("temp.ply", &info));
+  EXPECT_EQ(static_cast<size_t>(info.st_size), size);
+  EXPECT_GE(static_cast<size_t>(info.st_blocks) * 512, size);
+}
+#endif
+
+// === Test the streaming reader
+namespace {
+// Collects everything a PLYReader hands over
+class CollectingHandler : public happly::PLYHandler {
+public:
+  void beginElement(const std::string& name, size_t count) override {
+    EXPECT_EQ(currentElement, "");
+    currentElement = name;
+    counts[name] = count;
+  }
+  void records(happly::RecordBatch& batch) override {
+    EXPECT_EQ(batch.elementName(), currentElement);
+    EXPECT_LE(batch.size(), maxBatch);
+    if (currentElement == "vertex") {
+      EXPECT_EQ(batch.firstRecord, x.size());
+      const std::vector<float>& batchX = batch.column<float>("x");
+      x.insert(x.end(), batchX.begin(), batchX.end());
+      EXPECT_THROW(batch.column<double>("x"), std::runtime_error);
+    } else {
+      EXPECT_EQ(batch.firstRecord, faces.size());
+      const happly::TypedListProperty<int>& batchFaces = batch.listColumn<int>("vertex_indices");
+      for (size_t i = 0; i < batch.size(); i++) {
+        faces.emplace_back(batchFaces.flattenedData.begin() + batchFaces.flattenedIndexStart[i],
+                           batchFaces.flattenedData.begin() + batchFaces.flattenedIndexStart[i + 1]);
+      }
+    }
+  }
+  void endElement(const std::string& name) override {
+    EXPECT_EQ(currentElement, name);
+    currentElement = "";
+  }
+
+  size_t maxBatch = 0;
+  std::string currentElement;
+  std::map<std::string, size_t> counts;
+  std::vector<float> x;
+  std::vector<std::vector<int>> faces;
+};
+} // namespace
+
+TEST(StreamingReadTest, ReadInBatches) {
+
+  size_t N = 200000;
+  std::vector<float> dataX(N);
+  std::vector<double> dataD(N);
+  std::vector<std::vector<int>> faceInds(N);
+  for (size_t i = 0; i < N; i++) {
+    dataX[i] = static_cast<float>(i) * 0.5f;
+    dataD[i] = static_cast<double>(i);
+    faceInds[i] = std::vector<int>(i % 4 + 2, static_cast<int>(i));
+  }
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", N);
+  plyOut.getElement("vertex").addProperty<float>("x", dataX);
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+  plyOut.addElement("face", N);
+  plyOut.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+
+  for (happly::DataFormat format :
+       {happly::DataFormat::ASCII, happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+    plyOut.write("temp.ply", format);
+    for (size_t nThreads : {1, 4}) {
+      happly::ReadOptions options;
+      options.threads = nThreads;
+      options.projection["vertex"] = {"x"};
+      options.projection["face"] = {};
+
+      happly::PLYReader reader("temp.ply", options);
+      EXPECT_EQ(reader.getElementNames(), std::vector<std::string>({"vertex", "face"}));
+      CollectingHandler handler;
+      handler.maxBatch = 70000;
+      reader.read(handler, handler.maxBatch);
+      EXPECT_EQ(handler.counts["vertex"], N);
+      EXPECT_EQ(handler.counts["face"], N);
+      EXPECT_EQ(dataX, handler.x);
+      EXPECT_EQ(faceInds, handler.faces);
+      EXPECT_THROW(reader.read(handler), std::runtime_error);
+    }
+  }
+}
+
+TEST(StreamingReadTest, PullInLockstep) {
+
+  // Two files with the same vertices, but different layouts
+  size_t N = 100000;
+  std::vector<float> dataX(N);
+  std::vector<std::vector<int>> faceInds(N);
+  for (size_t i = 0; i < N; i++) {
+    dataX[i] = static_cast<float>(i) * 0.25f;
+    faceInds[i] = std::vector<int>(i % 3 + 1, static_cast<int>(i));
+  }
+  happly::PLYData plyA;
+  plyA.addElement("vertex", N);
+  plyA.getElement("vertex").addProperty<float>("x", dataX);
+  plyA.addElement("empty", 0);
+  plyA.addElement("face", N);
+  plyA.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+  plyA.write("temp.ply", happly::DataFormat::Binary);
+  happly::PLYData plyB;
+  plyB.addElement("face", N);
+  plyB.getElement("face").addListProperty<int>("vertex_indices", faceInds);
+  plyB.addElement("vertex", N);
+  plyB.getElement("vertex").addProperty<float>("x", dataX);
+  std::stringstream streamB;
+  plyB.write(streamB, happly::DataFormat::ASCII);
+
+  happly::PLYReader readerA("temp.ply");
+  happly::PLYReader readerB(streamB);
+  happly::RecordBatch chunkA(30000);
+  happly::RecordBatch chunkB(30000);
+  std::vector<std::string> elementsA;
+  std::vector<float> xA;
+  std::vector<std::vector<int>> facesB;
+  while (readerA.next(chunkA)) {
+    EXPECT_TRUE(readerB.next(chunkB));
+    EXPECT_EQ(chunkA.firstRecord, chunkB.firstRecord);
+    EXPECT_EQ(chunkA.size(), std::min<size_t>(30000, N - chunkA.firstRecord));
+    EXPECT_EQ(chunkA.size(), chunkB.size());
+    if (elementsA.empty() || elementsA.back() != chunkA.elementName()) elementsA.push_back(chunkA.elementName());
+
+    if (chunkA.elementName() == "vertex") {
+      xA.insert(xA.end(), chunkA.column<float>("x").begin(), chunkA.column<float>("x").end());
+    }
+    if (chunkB.elementName() == "face") {
+      const happly::TypedListProperty<int>& faces = chunkB.listColumn<int>("vertex_indices");
+      for (size_t i = 0; i < chunkB.size(); i++) {
+        facesB.emplace_back(faces.flattenedData.begin() + faces.flattenedIndexStart[i],
+                            faces.flattenedData.begin() + faces.flattenedIndexStart[i + 1]);
+      }
+    }
+  }
+  EXPECT_FALSE(readerB.next(chunkB));
+  EXPECT_FALSE(readerA.next(chunkA));
+  EXPECT_EQ(elementsA, std::vector<std::string>({"vertex", "face"}));
+  EXPECT_EQ(dataX, xA);
+  EXPECT_EQ(faceInds, facesB);
+}
+
+TEST(StreamingReadTest, ReadOptionsForFiles) {
+  size_t N = 50000;
+  std::vector<float> dataX(N);
+  for (size_t i = 0; i < N; i++) dataX[i] = static_cast<float>(i) - 0.5f;
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", N);
+  plyOut.getElement("vertex").addProperty<float>("x", dataX);
+  plyOut.write("temp.ply", happly::DataFormat::Binary);
+
+  happly::ReadOptions options;
+  options.asyncIO = true;
+  options.pageCache = happly::PageCacheMode::DropBehind;
+  options.bufferBytes = 1 << 12;
+#if !defined(_WIN32)
+  // Files are read through the requested I/O path, pushing or pulling
+  happly::PLYReader reader("temp.ply", options);
+  CollectingHandler handler;
+  handler.maxBatch = 7000;
+  reader.read(handler, handler.maxBatch);
+  EXPECT_EQ(dataX, handler.x);
+
+  happly::PLYReader puller("temp.ply", options);
+  happly::RecordBatch batch(7000);
+  std::vector<float> pulled;
+  while (puller.next(batch)) {
+    pulled.insert(pulled.end(), batch.column<float>("x").begin(), batch.column<float>("x").end());
+  }
+  EXPECT_EQ(dataX, pulled);
+#endif
+
+  // Options which can not be honoured are rejected rather than ignored
+  std::ifstream in("temp.ply", std::ios::binary);
+  EXPECT_THROW(happly::PLYReader streamReader(in, options), std::runtime_error);
+  std::vector<float> bound(N);
+  happly::ReadOptions bindOptions;
+  bindOptions.bind("vertex", "x", bound.data(), bound.size());
+  EXPECT_THROW(happly::PLYReader bindReader("temp.ply", bindOptions), std::runtime_error);
+}
+
+// === Test the streaming writer
+TEST(StreamingWriteTest, BatchesAndUnknownCounts) {
+
+  size_t N = 50000;
+  std::vector<float> dataX(N);
+  std::vector<std::vector<int>> faceInds(N);
+  for (size_t i = 0; i < N; i++) {
+    dataX[i] = static_cast<float>(i) * 0.5f;
+    faceInds[i] = std::vector<int>(i % 4 + 2, static_cast<int>(i));
+  }
+
+  for (happly::DataFormat format :
+       {happly::DataFormat::ASCII, happly::DataFormat::Binary, happly::DataFormat::BinaryBigEndian}) {
+    std::stringstream out;
+    {
+      // The vertex count is known, the others are not; "empty" never gets any records
+      happly::PLYWriter writer(out, format);
+      writer.comments.push_back("streamed");
+      writer.addElement("vertex", N);
+      writer.addProperty<float>("vertex", "x");
+      writer.addElement("face");
+      writer.addListProperty<int>("face", "vertex_indices");
+      writer.addElement("empty");
+      writer.addProperty<int>("empty", "i");
+
+      for (size_t iStart = 0; iStart < N; iStart += 7000) {
+        size_t iEnd = std::min(N, iStart + 7000);
+        happly::Element vertices("vertex", iEnd - iStart);
+        vertices.addProperty<float>("x", std::vector<float>(dataX.begin() + iStart, dataX.begin() + iEnd));
+        writer.write(vertices);
+        happly::Element faces("face", iEnd - iStart);
+        faces.addListProperty<int>("vertex_indices",
+                                   std::vector<std::vector<int>>(faceInds.begin() + iStart, faceInds.begin() + iEnd));
+        if (iEnd < N) {
+          EXPECT_THROW(writer.write(faces), std::runtime_error); // vertices are not finished
+        }
+      }
+      for (size_t iStart = 0; iStart < N; iStart += 9000) {
+        size_t iEnd = std::min(N, iStart + 9000);
+        happly::Element faces("face", iEnd - iStart);
+        faces.addListProperty<int>("vertex_indices",
+                                   std::vector<std::vector<int>>(faceInds.begin() + iStart, faceInds.begin() + iEnd));
+        writer.write(faces);
+      }
+      EXPECT_THROW(writer.addElement("late"), std::runtime_error);
+      writer.close();
+    }
+
+    happly::PLYData plyIn(out);
+    EXPECT_EQ(plyIn.comments.front(), "streamed");
+    EXPECT_EQ(dataX, plyIn.getElement("vertex").getProperty<float>("x"));
+    EXPECT_EQ(faceInds, plyIn.getElement("face").getListProperty<int>("vertex_indices"));
+    EXPECT_EQ(plyIn.getElement("empty").count, 0u);
+  }
+}
+
+TEST(StreamingWriteTest, PipeFromReaderAndErrors) {
+
+  // Copy a file batch by batch, changing its format
+  size_t N = 30000;
+  std::vector<double> dataD(N);
+  std::vector<std::vector<unsigned char>> dataL(N);
+  for (size_t i = 0; i < N; i++) {
+    dataD[i] = 0.1 * static_cast<double>(i);
+    dataL[i] = std::vector<unsigned char>(i % 3, static_cast<unsigned char>(i));
+  }
+  happly::PLYData plyOut;
+  plyOut.addElement("vertex", N);
+  plyOut.getElement("vertex").addProperty<double>("d", dataD);
+  plyOut.getElement("vertex").addListProperty<unsigned char>("l", dataL);
+  std::stringstream original;
+  plyOut.write(original, happly::DataFormat::Binary);
+
+  std::stringstream copy;
+  happly::PLYReader reader(original);
+  happly::PLYWriter writer(copy, happly::DataFormat::ASCII);
+  writer.addElement("vertex");
+  writer.addProperty<double>("vertex", "d");
+  writer.addListProperty<unsigned char>("vertex", "l");
+  happly::RecordBatch batch(4096);
+  while (reader.next(batch)) {
+    writer.write(batch.records);
+  }
+  writer.close();
+  happly::PLYData plyCopy(copy);
+  EXPECT_EQ(dataD, plyCopy.getElement("vertex").getProperty<double>("d"));
+  EXPECT_EQ(dataL, plyCopy.getElement("vertex").getListProperty<unsigned char>("l"));
+
+  // Records which do not match the declaration, too many records, and too few
+  std::stringstream bad;
+  happly::PLYWriter badWriter(bad, happly::DataFormat::Binary);
+  badWriter.addElement("vertex", 2);
+  badWriter.addProperty<float>("vertex", "x");
+  happly::Element wrongType("vertex", 1);
+  wrongType.addProperty<double>("x", std::vector<double>{1.});
+  EXPECT_THROW(badWriter.write(wrongType), std::runtime_error);
+  happly::Element undeclared("face", 1);
+  EXPECT_THROW(badWriter.write(undeclared), std::runtime_error);
+  happly::Element tooMany("vertex", 3);
+  tooMany.addProperty<float>("x", std::vector<float>{1.f, 2.f, 3.f});
+  EXPECT_THROW(badWriter.write(tooMany), std::runtime_error);
+  happly::Element tooFew("vertex", 1);
+  tooFew.addProperty<float>("x", std::vector<float>{1.f});
+  badWriter.write(tooFew);
+  EXPECT_THROW(badWriter.close(), std::runtime_error);
+}
+
 // === Test error and utility behavior
 
 // Errors get thrown
@@ -1009,6 +2310,42 @@ TEST(ErrorTest, WhiteSpaceInPropertyName) {
   EXPECT_THROW(ply.validate(), std::runtime_error);
 }
 
+TEST(ErrorTest, TruncatedBinary) {
+  happly::PLYData ply;
+  ply.addElement("test_elem", 3);
+  std::vector<int> data{1, 3, 4};
+  ply.getElement("test_elem").addProperty("data", data);
+
+  std::stringstream ioBuffer;
+  ply.write(ioBuffer, happly::DataFormat::Binary);
+  std::string contents = ioBuffer.str();
+  std::stringstream truncated(contents.substr(0, contents.size() - 2));
+
+  EXPECT_THROW(happly::PLYData plyIn(truncated), std::runtime_error);
+}
+
+TEST(ErrorTest, TruncatedASCII) {
+  happly::PLYData ply;
+  ply.addElement("test_elem", 3);
+  std::vector<int> data{1, 3, 4};
+  ply.getElement("test_elem").addProperty("data", data);
+
+  std::stringstream ioBuffer;
+  ply.write(ioBuffer, happly::DataFormat::ASCII);
+  std::string contents = ioBuffer.str();
+  std::stringstream truncated(contents.substr(0, contents.size() - 2));
+
+  EXPECT_THROW(happly::PLYData plyIn(truncated), std::runtime_error);
+}
+
+TEST(ErrorTest, BadASCIIValues) {
+  std::string header = "ply\nformat ascii 1.0\nelement v 1\nproperty int a\nproperty list uchar int l\nend_header\n";
+  for (std::string data : {"1 2 3\n", "1\n", "x 0\n", "1 3 1 2 x\n"}) {
+    std::stringstream in(header + data);
+    EXPECT_THROW(happly::PLYData plyIn(in), std::runtime_error);
+  }
+}
+
 
 // Removal
 TEST(RemovalTest, RemoveReplaceTest) {
@@ -1149,6 +2486,36 @@ TEST(TypePromotionTest, FaceIndThrow) {
   EXPECT_THROW(ply.getElement("face").addListProperty("vertex_indices", faceInds), std::runtime_error);
 }
 
+TEST(TypePromotionTest, FlatListAndFaceInd) {
+  happly::PLYData ply;
+  std::vector<std::vector<short>> faceInds{{1, 3, 4}, {0, -2, 4, 5}, {}};
+  ply.addElement("face", faceInds.size());
+  ply.getElement("face").addListProperty("vertex_indices", faceInds);
+  happly::Element& face = ply.getElement("face");
+
+  // Promotes to larger types, agreeing with the nested getters
+  happly::FlatList<int> flatI = face.getListPropertyFlat<int>("vertex_indices");
+  EXPECT_EQ(std::vector<int>({1, 3, 4, 0, -2, 4, 5}), flatI.flattenedData);
+  EXPECT_EQ(std::vector<size_t>({0, 3, 7, 7}), flatI.flattenedIndexStart);
+  ASSERT_EQ(flatI.size(), faceInds.size());
+  EXPECT_EQ(-2, flatI[1][1]);
+  EXPECT_TRUE(flatI[2].empty());
+  EXPECT_THROW(face.getListPropertyFlat<char>("vertex_indices"), std::runtime_error);
+  EXPECT_THROW(face.getListPropertyFlat<unsigned int>("vertex_indices"), std::runtime_error);
+
+  // Crosses signedness only when asked to, as getFaceIndices() does
+  happly::FlatList<size_t> flatFace = ply.getFaceIndicesFlat();
+  std::vector<std::vector<size_t>> nested = ply.getFaceIndices();
+  happly::ListSpan<const size_t> view = flatFace.view();
+  ASSERT_EQ(view.size(), nested.size());
+  for (size_t i = 0; i < nested.size(); i++) {
+    EXPECT_EQ(nested[i], std::vector<size_t>(view[i].begin(), view[i].end()));
+  }
+
+  happly::PLYData noFaces;
+  EXPECT_THROW(noFaces.getFaceIndicesFlat<int>(), std::runtime_error);
+}
+
 // === Test reading mesh-like files
 TEST(MeshTest, ReadWriteASCIIMesh) {
 